@@ -1,42 +1,146 @@
 // Solves: https://www.hackerrank.com/challenges/fraudulent-activity-notifications/problem?isFullScreen=true
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
+#if defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 
-template<typename TValue>
-class BinaryHeapNode;
-
-template<typename TValue>
-class BinaryHeap;
-
-template<typename TValue>
 class BinaryHeapNode {
 public:
     int index;
-    TValue value;
-    BinaryHeap<TValue>* heap;
-
-    // copy and move constructor and assignment not implemented
-    BinaryHeapNode(const BinaryHeapNode&)=delete;
-    BinaryHeapNode& operator=(const BinaryHeapNode&)=delete;
-    BinaryHeapNode(const BinaryHeapNode&&)=delete;
-    BinaryHeapNode& operator=(const BinaryHeapNode&&)=delete;
+    int heapId;
 
     /// @brief Constructs new binary heap node
-    /// @param index The index of this node in the underlying heap vector
-    /// @param value The value of the node
-    /// @param heap A pointer to the heap this node belongs to
-    BinaryHeapNode(int index, TValue value, BinaryHeap<TValue>* heap) :
+    /// @param index The index of this node in the underlying heap vectors
+    /// @param heapId The id of the heap this node belongs to
+    BinaryHeapNode(int index, int heapId) :
         index{index},
-        value{value},
-        heap{heap}
+        heapId{heapId}
     {}
 };
 
 template<typename TValue>
+class BinaryHeapSlab {
+public:
+    // copy and move constructor and assignment not implemented
+    BinaryHeapSlab(const BinaryHeapSlab&)=delete;
+    BinaryHeapSlab& operator=(const BinaryHeapSlab&)=delete;
+    BinaryHeapSlab(const BinaryHeapSlab&&)=delete;
+    BinaryHeapSlab& operator=(const BinaryHeapSlab&&)=delete;
+
+    /// @brief Constructs a slab of heap nodes. Nodes are stored contiguously and are referred to
+    /// by handle (their index in the slab), so a handle stays valid while the heap reorders
+    /// itself and even when the node moves to another heap sharing the same slab.
+    /// @param capacity The maximum number of nodes the slab can hold
+    BinaryHeapSlab(int capacity) :
+        nodes{},
+        heapCount{0},
+        freeHead{NoNode},
+        freeCount{0}
+    {
+        if (capacity < 1)
+        {
+            throw std::out_of_range("Capacity must be greater than 0");
+        }
+
+        nodes.reserve(capacity);
+    }
+
+    /// @brief Returns the number of nodes allocated from the slab and not yet freed
+    /// @return 
+    int size() const
+    {
+        return nodes.size() - freeCount;
+    }
+
+    /// @brief Returns the maximum number of nodes that can be allocated from the slab
+    /// @return 
+    int capacity() const
+    {
+        return nodes.capacity();
+    }
+
+    /// @brief Registers a heap sharing the slab. Heaps sharing a slab may order their values
+    /// differently and so be of different types, so nodes refer to their heap by id.
+    /// @return The id of the heap
+    int addHeap()
+    {
+        return heapCount++;
+    }
+
+    /// @brief Allocates a new node from the slab. Never reallocates the underlying storage.
+    /// @param index The index of the node in the heap it belongs to
+    /// @param heapId The id of the heap the node belongs to
+    /// @return The handle of the new node
+    int allocate(int index, int heapId)
+    {
+        // reuse the most recently freed node first
+        if (freeHead != NoNode)
+        {
+            int handle = freeHead;
+            freeHead = nodes[handle].index;
+            freeCount--;
+            nodes[handle] = BinaryHeapNode(index, heapId);
+            return handle;
+        }
+
+        if (size() == capacity())
+        {
+            throw std::runtime_error("Slab is full!");
+        }
+
+        nodes.emplace_back(index, heapId);
+        return nodes.size() - 1;
+    }
+
+    /// @brief Returns a node to the slab so a later allocation can reuse it. Freed nodes are
+    /// chained through their index.
+    /// @param handle The handle of a node no heap refers to any more
+    void deallocate(int handle)
+    {
+        nodes[handle].index = freeHead;
+        freeHead = handle;
+        freeCount++;
+    }
+
+    BinaryHeapNode& operator[](int handle)
+    {
+        return nodes[handle];
+    }
+
+    const BinaryHeapNode& operator[](int handle) const
+    {
+        return nodes[handle];
+    }
+
+private:
+    static constexpr int NoNode = -1;
+
+    std::vector<BinaryHeapNode> nodes;
+    int heapCount;
+    /// @brief The most recently freed node, or NoNode
+    int freeHead;
+    int freeCount;
+};
+
+template<typename TValue, typename TCompare = std::less<TValue>, int Arity = 2>
 class BinaryHeap {
 public:
+    static_assert(Arity >= 2, "A heap node needs at least two children");
+
+    /// @brief The handle returned when a heap has no root
+    static constexpr int NoNode = -1;
+
     // copy and move constructor and assignment not implemented
     BinaryHeap(const BinaryHeap&)=delete;
     BinaryHeap& operator=(const BinaryHeap&)=delete;
@@ -45,39 +149,51 @@ public:
 
     /// @brief Constructs a binary heap. This class offers similar functionality to the STL heap
     /// algothims but allows arbitrary nodes to be updated while maintaining the heap property.
-    /// When arbitrary nodes are updated, the heap is fixed up in logarithmic time.
-    /// @param isMaxHeap True if max heap, false if min heap
+    /// When arbitrary nodes are updated, the heap is fixed up in logarithmic time. Like
+    /// std::priority_queue, the root is the value that no other value compares greater than, so
+    /// std::less gives a max heap and std::greater a min heap. With an Arity above 2 the heap is
+    /// d-ary: each node has Arity children stored next to each other, so the tree is shallower
+    /// and a sift down touches fewer cache lines, at the cost of more comparisons per level.
     /// @param capacity The maximum number of elements to store in the heap
-    BinaryHeap(bool isMaxHeap, int capacity) :
-        isMaxHeap{isMaxHeap},
-        heap{}
-    {
-        if (capacity < 1)
-        {
-            throw std::out_of_range("Capacity must be greater than 0");
-        }
+    /// @param compare Returns true if the first value belongs below the second value
+    BinaryHeap(int capacity, TCompare compare = TCompare()) :
+        BinaryHeap(capacity, nullptr, compare)
+    { }
 
-        heap.reserve(capacity);
-    }
+    /// @brief Constructs a binary heap whose nodes are allocated from a slab shared with other
+    /// heaps. Roots can only be swapped between heaps sharing a slab.
+    /// @param capacity The maximum number of elements to store in the heap
+    /// @param slab The slab to allocate nodes from. Must outlive the heap.
+    /// @param compare Returns true if the first value belongs below the second value
+    BinaryHeap(int capacity, BinaryHeapSlab<TValue>& slab, TCompare compare = TCompare()) :
+        BinaryHeap(capacity, &slab, compare)
+    { }
 
     /// @brief Returns the number of nodes currently in the heap
     /// @return 
     int size() const
     {
-        return heap.size();
+        return handles.size();
     }
 
     /// @brief Returns the maximum number of nodes that can be in the heap
     /// @return 
     int capacity() const
     {
-        return heap.capacity();
+        return handles.capacity();
+    }
+
+    /// @brief Returns the id of the heap in its slab, which every node in the heap refers to
+    /// @return 
+    int getId() const
+    {
+        return id;
     }
 
     /// @brief adds a new element to the heap
     /// @param value The value of the new element to add
-    /// @return A reference to the newly added heap node
-    BinaryHeapNode<TValue>& add(TValue value)
+    /// @return The handle of the newly added heap node
+    int add(TValue value)
     {
         int count = size();
         if (count == capacity())
@@ -85,280 +201,374 @@ public:
             throw std::runtime_error("Heap is full!");
         }
 
-        // allocate a new node on the heap and add reference to the end of the heap vector
-        BinaryHeapNode<TValue>* node = new BinaryHeapNode<TValue>(count, value, this);
-        heap.push_back(node);
+        // take a node from the slab and open a hole at the end of the heap vectors, then let the
+        // value rise from there to maintain the heap property
+        int handle = slab->allocate(count, id);
+        values.push_back(std::move(value));
+        handles.push_back(handle);
+        siftUp(count, std::move(values[count]), handle);
+
+        return handle;
+    }
+
+    /// @brief Adds a range of values to the heap in linear time. The values are appended
+    /// unordered, then Floyd's heapify sifts down every parent, starting from the last one, so
+    /// most values only move a level or two instead of rising through the whole tree.
+    /// @param first Iterator to the first value
+    /// @param last Iterator past the last value
+    /// @param handlesOut Iterator receiving the handle of each value, in the order of the range
+    /// @return Iterator past the last handle written
+    template<typename ForwardIt, typename OutputIt>
+    OutputIt build(ForwardIt first, ForwardIt last, OutputIt handlesOut)
+    {
+        int count = size();
+        if (std::distance(first, last) > capacity() - count)
+        {
+            throw std::runtime_error("Heap is too small to build!");
+        }
+
+        for (; first != last; ++first)
+        {
+            int handle = slab->allocate(size(), id);
+            values.push_back(*first);
+            handles.push_back(handle);
+            *handlesOut = handle;
+            ++handlesOut;
+        }
 
-        // now fix up the heap to maintain the heap property
-        fixHeap(node, true);
+        for (int parent = (size() - 2) / Arity; (size() > 1) && (parent >= 0); parent--)
+        {
+            siftDown(parent, std::move(values[parent]), handles[parent]);
+        }
 
-        return *node;
+        return handlesOut;
     }
 
     /// @brief Updates the value in the specified node, fixing up the heap to maintain the heap
     /// property
-    /// @param node The node to update
+    /// @param handle The handle of the node to update
     /// @param value The new value
-    void update(BinaryHeapNode<TValue>& node, TValue value)
+    void update(int handle, TValue value)
     {
-        auto oldValue = node.value;
+        int index = (*slab)[handle].index;
 
-        // dont need to do anything if value is the same
-        if (value != oldValue)
+        if (compare(values[index], value))
+        {
+            siftUp(index, std::move(value), handle);
+        }
+        else if (compare(value, values[index]))
+        {
+            siftDown(index, std::move(value), handle);
+        }
+        else
+        {
+            // neither is ordered before the other, so the node stays where it is
+            values[index] = std::move(value);
+        }
+    }
+
+    /// @brief Removes the specified node from the heap and returns it to the slab. The last
+    /// entry of the heap fills the hole and is sifted whichever way it needs to go.
+    /// @param handle The handle of the node to remove. Invalid afterwards.
+    void remove(int handle)
+    {
+        removeAt((*slab)[handle].index);
+        slab->deallocate(handle);
+    }
+
+    /// @brief Moves the root of this heap into the other heap, keeping its handle, and fixes up
+    /// both heaps to maintain the heap property.
+    /// @param otherHeap The heap to move the root to. May order its values differently.
+    template<typename TOtherCompare, int OtherArity>
+    void transferRoot(BinaryHeap<TValue, TOtherCompare, OtherArity>& otherHeap)
+    {
+        if (size() == 0)
+        {
+            throw std::runtime_error("Heap is empty! Can't transfer root");
+        }
+        if (otherHeap.size() == otherHeap.capacity())
+        {
+            throw std::runtime_error("Heap is full!");
+        }
+        if (slab != otherHeap.slab)
         {
-            bool moveUp = shouldMoveUp(value, oldValue);
-            node.value = value;
-            fixHeap(&node, moveUp);
+            throw std::invalid_argument("Heaps don't share a slab! Can't transfer root");
         }
+
+        int handle = handles[0];
+        TValue value = std::move(values[0]);
+        removeAt(0);
+
+        int count = otherHeap.size();
+        (*slab)[handle].heapId = otherHeap.id;
+        otherHeap.values.push_back(std::move(value));
+        otherHeap.handles.push_back(handle);
+        otherHeap.siftUp(count, std::move(otherHeap.values[count]), handle);
     }
 
     /// @brief Swaps the root of this heap with the root of the other heap, fixing up both heaps to
     /// maintain the heap property.
-    /// @param otherHeap The other heap to swap roots with
-    void swapRoot(BinaryHeap<TValue>& otherHeap)
+    /// @param otherHeap The other heap to swap roots with. May order its values differently.
+    template<typename TOtherCompare, int OtherArity>
+    void swapRoot(BinaryHeap<TValue, TOtherCompare, OtherArity>& otherHeap)
     {
-        auto ourRootPtr = getRoot();
-        auto theirRootPtr = otherHeap.getRoot();
-        if ((ourRootPtr == nullptr) || (theirRootPtr == nullptr))
+        if ((size() == 0) || (otherHeap.size() == 0))
         {
             throw std::runtime_error("One of the heaps is empty! Can't swap roots");
         }
+        if (slab != otherHeap.slab)
+        {
+            throw std::invalid_argument("Heaps don't share a slab! Can't swap roots");
+        }
 
-        // perform the swap. first update the heap each node is pointing to, then swap the actual
-        // root nodes in the underlying vector
-        std::swap(ourRootPtr->heap, theirRootPtr->heap);
-        std::swap(heap[0], otherHeap.heap[0]);
+        // take both roots out, leaving a hole at the top of each heap, and point each node at
+        // the heap it moves to. then sink each value down from the other heap's hole.
+        int handle = handles[0];
+        int otherHandle = otherHeap.handles[0];
+        TValue value = std::move(values[0]);
+        TValue otherValue = std::move(otherHeap.values[0]);
+        (*slab)[handle].heapId = otherHeap.id;
+        (*slab)[otherHandle].heapId = id;
 
-        // now fix up the heaps
-        fixHeap(heap[0], false);
-        otherHeap.fixHeap(otherHeap.heap[0], false);
+        siftDown(0, std::move(otherValue), otherHandle);
+        otherHeap.siftDown(0, std::move(value), handle);
     }
 
-    /// @brief Returns the root node or a nullptr if the heap is empty
+    /// @brief Returns the handle of the root node or NoNode if the heap is empty
     /// @return 
-    BinaryHeapNode<TValue>* getRoot() const
+    int getRoot() const
     {
-        BinaryHeapNode<TValue>* result = nullptr;
+        int result = NoNode;
 
         if (size() > 0)
         {
-            result = heap[0];
+            result = handles[0];
         }
 
         return result;
     }
 
-    /// @brief Destroys a binary heap
-    ~BinaryHeap()
+    /// @brief Returns the value of the root node. The heap must not be empty.
+    /// @return 
+    const TValue& getRootValue() const
     {
-        // need to clean up the dynamically allocated nodes
-        for (auto node: heap)
-        {
-            delete node;
-        }
+        return values[0];
     }
 
-private:
-    bool isMaxHeap;
-    // TODO: use unique pointer and remove associated destructor code
-    /// @brief The underlying heap vector. A vector of pointers to nodes.
-    std::vector<BinaryHeapNode<TValue>*> heap;
-
-    /// @brief fixes up the heap when a node's value is changed
-    /// @param node The node that was updated
-    /// @param moveUp Indicates if the node should be sifted up or down
-    void fixHeap(BinaryHeapNode<TValue>* node, bool moveUp)
+    /// @brief Returns the value stored in the specified node
+    /// @param handle The handle of a node in this heap
+    /// @return 
+    const TValue& getValue(int handle) const
     {
-        bool continueSwapping = true;
-        while (continueSwapping)
-        {
-            auto swapWith = moveUp
-                ? getSwapUp(node)
-                : getSwapDown(node);
-            
-            if (swapWith != nullptr)
-            {
-                swapNodes(node, swapWith);
-            }
-            else
-            {
-                continueSwapping = false;
-            }
-        }
+        return values[(*slab)[handle].index];
     }
 
-    /// @brief Swaps the position of two nodes in the heap
-    /// @param node 
-    /// @param otherNode 
-    void swapNodes(BinaryHeapNode<TValue>* node, BinaryHeapNode<TValue>* otherNode)
-    {
-        // update the indexes first then swap the underlying pointers in the vector
-        std::swap(node->index, otherNode->index);
-        std::swap(heap[node->index], heap[otherNode->index]);
-    }
+private:
+    // heaps with other comparators swap roots with this one
+    template<typename, typename, int>
+    friend class BinaryHeap;
 
-    /// @brief Returns the parent node of the specified node if the node needs to be moved up to satisfy
-    /// the heap property. Returns nullptr if the node does not need to be moved up.
-    /// @param node 
-    /// @return 
-    BinaryHeapNode<TValue>* getSwapUp(BinaryHeapNode<TValue>* node)
+    TCompare compare;
+    /// @brief The slab owned by this heap, or nullptr if the heap shares another slab
+    std::unique_ptr<BinaryHeapSlab<TValue>> ownedSlab;
+    /// @brief The slab nodes are allocated from, maps node handles to heap indexes
+    BinaryHeapSlab<TValue>* slab;
+    int id;
+    /// @brief The underlying heap vectors. Values are stored inline, in heap order, alongside
+    /// the handle of the node they belong to so sifting never leaves these two arrays.
+    std::vector<TValue> values;
+    std::vector<int> handles;
+
+    BinaryHeap(int capacity, BinaryHeapSlab<TValue>* sharedSlab, TCompare compare) :
+        compare{compare},
+        ownedSlab{},
+        slab{sharedSlab},
+        id{0},
+        values{},
+        handles{}
     {
-        BinaryHeapNode<TValue>* result = nullptr;
+        if (capacity < 1)
+        {
+            throw std::out_of_range("Capacity must be greater than 0");
+        }
 
-        auto parent = getParent(node);
-        if (parent != nullptr)
+        if (slab == nullptr)
         {
-            bool shouldMove = shouldMoveUp(node->value, parent->value);
-            if (shouldMove)
-            {
-                result = parent;
-            }
+            ownedSlab = std::make_unique<BinaryHeapSlab<TValue>>(capacity);
+            slab = ownedSlab.get();
         }
+        id = slab->addHeap();
 
-        return result;
+        values.reserve(capacity);
+        handles.reserve(capacity);
     }
 
-    /// @brief Returns the child node of the specified node if the node needs to be moved down to
-    /// satisfy the heap property. Returns nullptr if the node does not need to be moved down.
-    /// @param node 
-    /// @return 
-    BinaryHeapNode<TValue>* getSwapDown(BinaryHeapNode<TValue>* node)
+    /// @brief Removes the entry at the given index, filling the hole with the last entry
+    /// @param index 
+    void removeAt(int index)
     {
-        BinaryHeapNode<TValue>* result = nullptr;
+        int last = size() - 1;
+        TValue value = std::move(values[last]);
+        int handle = handles[last];
+        values.pop_back();
+        handles.pop_back();
 
-        auto candidateChild = getMaxOrMinChild(node);
-        if (candidateChild != nullptr)
+        if (index == last)
         {
-            bool shouldMove = shouldMoveDown(node->value, candidateChild->value);
-            if (shouldMove)
-            {
-                result = candidateChild;
-            }
+            return;
         }
 
-        return result;
-    }
-    
-    /// @brief Indicates if the first value should be moved up in the heap, relative to the second value, to
-    /// satisfy the heap property.
-    /// @param firstValue 
-    /// @param secondValue 
-    /// @return 
-    bool shouldMoveUp(TValue firstValue, TValue secondValue)
-    {
-        return isMaxHeap
-            ? (firstValue > secondValue)
-            : (firstValue < secondValue);
+        // the last entry came from another branch of the tree, so it may belong above or below
+        if ((index > 0) && compare(values[(index - 1) / Arity], value))
+        {
+            siftUp(index, std::move(value), handle);
+        }
+        else
+        {
+            siftDown(index, std::move(value), handle);
+        }
     }
 
-    /// @brief Indicates if the first value should be moved down in the heap, relative to the second value, to
-    /// satisfy the heap property.
-    /// @param firstValue 
-    /// @param secondValue 
-    /// @return 
-    bool shouldMoveDown(TValue firstValue, TValue secondValue)
+    /// @brief Moves the entry at one index into the hole at another, pointing its node at the
+    /// new index
+    /// @param from 
+    /// @param hole 
+    void moveIntoHole(int from, int hole)
     {
-        return isMaxHeap
-            ? (firstValue < secondValue)
-            : (firstValue > secondValue);
+        values[hole] = std::move(values[from]);
+        handles[hole] = handles[from];
+        (*slab)[handles[hole]].index = hole;
     }
 
-    /// @brief Returns the parent of a given node, or nullptr if the node is the root node
-    /// @param node The node to get the parent for
-    /// @return Pointer to parent node or nullptr if no parent
-    BinaryHeapNode<TValue>* getParent(BinaryHeapNode<TValue>* node)
+    /// @brief Places a value into the hole at the given index, then moves the hole up past every
+    /// parent ordered below the value. Parents are moved down one level instead of swapped.
+    /// @param hole The index of the hole
+    /// @param value The value to place
+    /// @param handle The handle of the node the value belongs to
+    void siftUp(int hole, TValue value, int handle)
     {
-        BinaryHeapNode<TValue>* result = nullptr;
-        int nodeIndex = node->index;
-
-        if (nodeIndex > 0)
+        while (hole > 0)
         {
-            // even indexed nodes are always righthand children.
-            bool isEven = ((nodeIndex % 2) == 0);
-            int offset = isEven ? 1 : 0;
-            int parentIndex = (nodeIndex - offset - 1) / 2;
+            int parent = (hole - 1) / Arity;
+            if (!compare(values[parent], value))
+            {
+                break;
+            }
 
-            result = heap[parentIndex];
+            moveIntoHole(parent, hole);
+            hole = parent;
         }
 
-        return result;
+        values[hole] = std::move(value);
+        handles[hole] = handle;
+        (*slab)[handle].index = hole;
     }
-    
-    /// @brief Returns the left child of a given node, or nullptr if the node doesnt have a left child
-    /// @param node The node to get the left child of
-    /// @return Pointer to left child node or nullptr if no left child
-    BinaryHeapNode<TValue>* getLeftChild(BinaryHeapNode<TValue>* node)
+
+    /// @brief Places a value into the hole at the given index, then moves the hole down past
+    /// every child ordered above the value, always following the highest of the children.
+    /// @param hole The index of the hole
+    /// @param value The value to place
+    /// @param handle The handle of the node the value belongs to
+    void siftDown(int hole, TValue value, int handle)
     {
-        BinaryHeapNode<TValue>* result = nullptr;
-        int nodeIndex = node->index;
-        int halfCapacity = capacity() / 2;
+        int count = size();
 
-        // a crude check to avoid integer overflow
-        if (nodeIndex < halfCapacity)
+        while (true)
         {
-            // odd indexed nodes are always lefthand children.
-            int childIndex = (nodeIndex * 2) + 1;
-            if (childIndex < size())
+            long long firstChild = (static_cast<long long>(Arity) * hole) + 1;
+            if (firstChild >= count)
             {
-                result = heap[childIndex];
+                break;
             }
+
+            int child = getHighestChild(firstChild, std::min<long long>(Arity, count - firstChild));
+            if (!compare(value, values[child]))
+            {
+                break;
+            }
+
+            moveIntoHole(child, hole);
+            hole = child;
         }
 
-        return result;
+        values[hole] = std::move(value);
+        handles[hole] = handle;
+        (*slab)[handle].index = hole;
     }
 
-    /// @brief Returns the right child of a given node, or nullptr if the node doesnt have a right child
-    /// @param node The node to get the right child of
-    /// @return Pointer to right child node or nullptr if no right child
-    BinaryHeapNode<TValue>* getRightChild(BinaryHeapNode<TValue>* node)
+    /// @brief Returns the index of the child no other child is ordered above. The first such
+    /// child wins ties.
+    /// @param firstChild The index of the first child
+    /// @param childCount The number of children, at most Arity
+    /// @return 
+    int getHighestChild(int firstChild, int childCount) const
     {
-        BinaryHeapNode<TValue>* result = nullptr;
-        int nodeIndex = node->index;
-        int halfCapacity = capacity() / 2;
-
-        // a crude check to avoid integer overflow
-        if (nodeIndex < halfCapacity)
+#if defined(__SSE4_1__)
+        // a full set of int children is compared in a few vector instructions instead of a chain
+        // of dependent comparisons
+        if constexpr (std::is_same_v<TValue, int> && (Arity == 4 || Arity == 8)
+            && (std::is_same_v<TCompare, std::less<int>> || std::is_same_v<TCompare, std::greater<int>>))
         {
-            // even indexed nodes are always righthand children.
-            int childIndex = (nodeIndex * 2) + 2;
-            if (childIndex < size())
+            if (childCount == Arity)
             {
-                result = heap[childIndex];
+                return firstChild + getExtremeLane(&values[firstChild]);
             }
         }
+#endif
+
+        int result = firstChild;
+        for (int child = firstChild + 1; child < firstChild + childCount; child++)
+        {
+            result = compare(values[result], values[child]) ? child : result;
+        }
 
         return result;
     }
-    
-    /// @brief Gets the child with the greater value (if max heap) or smaller value (min heap). Returns
-    /// nullptr if the node does not have any children.
-    /// @param node The node to get the max child for
+
+#if defined(__SSE4_1__)
+    /// @brief Returns the lane holding the largest value for a max heap or the smallest for a
+    /// min heap, of Arity ints. The extreme is broadcast to every lane by repeatedly combining
+    /// the vector with a shuffle of itself, then found again with a compare and movemask.
+    /// @param children 
     /// @return 
-    BinaryHeapNode<TValue>* getMaxOrMinChild(BinaryHeapNode<TValue>* node)
+    static int getExtremeLane(const int* children)
     {
-        BinaryHeapNode<TValue>* result = nullptr;
-        auto leftChild = getLeftChild(node);
-        auto rightChild = getRightChild(node);
+        constexpr bool isMaxHeap = std::is_same_v<TCompare, std::less<int>>;
 
-        if (leftChild == nullptr)
+#if defined(__AVX2__)
+        if constexpr (Arity == 8)
         {
-            // right child may still be null, but thats ok, returning nullptr indicates no children
-            result = rightChild;
+            auto extreme = [](__m256i first, __m256i second) {
+                return isMaxHeap ? _mm256_max_epi32(first, second) : _mm256_min_epi32(first, second);
+            };
+            __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(children));
+            __m256i result = extreme(lanes, _mm256_permute2x128_si256(lanes, lanes, 1));
+            result = extreme(result, _mm256_shuffle_epi32(result, 0x4e));
+            result = extreme(result, _mm256_shuffle_epi32(result, 0xb1));
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(lanes, result)));
+            return __builtin_ctz(mask);
         }
-        else if (rightChild == nullptr)
-        {
-            // left child may still be null, but thats ok, returning nullptr indicates no children
-            result = leftChild;
-        }
-        else
+#endif
+
+        auto extreme = [](__m128i first, __m128i second) {
+            return isMaxHeap ? _mm_max_epi32(first, second) : _mm_min_epi32(first, second);
+        };
+        int result = 0;
+        for (int offset = 0; offset < Arity; offset += 4)
         {
-            // use the largest child for max heap and smallest for min heap
-            bool useLeftChild = shouldMoveUp(leftChild->value, rightChild->value);
-            result = useLeftChild ? leftChild : rightChild;
+            __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(children + offset));
+            __m128i best = extreme(lanes, _mm_shuffle_epi32(lanes, 0x4e));
+            best = extreme(best, _mm_shuffle_epi32(best, 0xb1));
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(lanes, best)));
+            int lane = offset + __builtin_ctz(mask);
+            // only a strictly higher value replaces the one found in an earlier group
+            result = ((offset == 0) || (isMaxHeap ? children[lane] > children[result] : children[lane] < children[result]))
+                ? lane
+                : result;
         }
-
         return result;
     }
+#endif
 };
 
 template<typename TValue>
@@ -392,11 +602,11 @@ public:
         
         // Use the max heap root if the number of samples is odd or both heap roots if the number of
         // samples is even.
-        int low_median = maxHeap.getRoot()->value;
+        int low_median = maxHeap.getRootValue();
         int high_median = low_median;
         if (maxHeap.size() == minHeap.size())
         {
-            high_median = minHeap.getRoot()->value;
+            high_median = minHeap.getRootValue();
         }
 
         return low_median + high_median;
@@ -405,14 +615,146 @@ public:
     /// @brief Add a sample to the moving median calculation
     /// @param value 
     void add(TValue value)
+    {
+        addSample(value);
+        balanceRoots();
+    }
+
+    /// @brief Fills an empty moving median calculation with samples in linear time, e.g. when
+    /// replaying a window after a restart. This gives the same result as adding each sample
+    /// individually, but instead of every sample being sifted into a heap, nth_element splits the
+    /// window into its lower and upper halves and each half is heapified at once.
+    /// @param first Iterator to the first sample
+    /// @param last Iterator past the last sample
+    template<typename ForwardIt>
+    void prime(ForwardIt first, ForwardIt last)
+    {
+        if (getCount() > 0)
+        {
+            throw std::runtime_error("Already have samples! Can't prime");
+        }
+
+        // only the last maxSamples samples survive, each in the ring slot it would have been
+        // added to
+        long long total = std::distance(first, last);
+        int count = std::min<long long>(total, maxSamples);
+        std::advance(first, total - count);
+
+        std::vector<std::pair<TValue, int>> window;
+        window.reserve(count);
+        for (long long sample = total - count; first != last; ++first, sample++)
+        {
+            window.emplace_back(*first, static_cast<int>(sample % maxSamples));
+        }
+
+        // the max heap takes the lower half, with the middle value when the count is odd
+        int lowerCount = (count / 2) + (count % 2);
+        auto byValue = [](const std::pair<TValue, int>& entry, const std::pair<TValue, int>& otherEntry) {
+            return entry.first < otherEntry.first;
+        };
+        std::nth_element(window.begin(), window.begin() + lowerCount, window.end(), byValue);
+
+        std::vector<TValue> splitValues;
+        splitValues.reserve(count);
+        for (const auto& entry : window)
+        {
+            splitValues.push_back(entry.first);
+        }
+
+        std::vector<int> handles(count);
+        maxHeap.build(splitValues.begin(), splitValues.begin() + lowerCount, handles.begin());
+        minHeap.build(splitValues.begin() + lowerCount, splitValues.end(), handles.begin() + lowerCount);
+
+        samples.resize(count);
+        for (int i = 0; i < count; i++)
+        {
+            samples[window[i].second] = handles[i];
+        }
+        sampleIndex = total % maxSamples;
+    }
+
+    /// @brief Add a batch of samples to the moving median calculation. This gives the same result
+    /// as adding each sample individually, but the heap roots are only reconciled once for the
+    /// whole batch and samples that would be replaced by later samples in the same batch are
+    /// never added to the heaps.
+    /// @param first Iterator to the first sample
+    /// @param last Iterator past the last sample
+    template<typename ForwardIt>
+    void addBatch(ForwardIt first, ForwardIt last)
+    {
+        int remaining = std::distance(first, last);
+
+        // fill the window first, the ring only wraps once it's full
+        while ((remaining > 0) && (getCount() < maxSamples))
+        {
+            addSample(*first);
+            ++first;
+            remaining--;
+        }
+
+        // once the window is full, only the last maxSamples samples of the batch survive. each
+        // skipped sample would have landed in a ring slot that is overwritten again below.
+        if (remaining > maxSamples)
+        {
+            int skipped = remaining - maxSamples;
+            std::advance(first, skipped);
+            sampleIndex = (sampleIndex + skipped) % maxSamples;
+        }
+
+        for (; first != last; ++first)
+        {
+            addSample(*first);
+        }
+
+        balanceRoots();
+    }
+
+private:
+    // both heaps allocate their nodes from one slab so the sample ring can hold plain handles
+    // that stay valid when a node is moved between heaps by swapRoot. the slab is declared
+    // first because the heaps refer to it.
+    BinaryHeapSlab<TValue> slab;
+    BinaryHeap<TValue, std::less<TValue>> maxHeap;
+    BinaryHeap<TValue, std::greater<TValue>> minHeap;
+    int maxSamples;
+    int sampleIndex;
+    std::vector<int> samples;
+
+    MovingMedian(int maxSamples, int maxHeapCapacity) :
+        slab(std::max(1, maxSamples)),
+        maxHeap(std::max(1, maxHeapCapacity), slab),
+        minHeap(std::max(1, maxSamples - maxHeapCapacity), slab),
+        maxSamples{maxSamples},
+        sampleIndex{0},
+        samples{}
+    {
+        if (maxSamples < 1)
+        {
+            throw std::out_of_range("Max samples must be greater than 0");
+        }
+
+        samples.reserve(maxSamples);
+    }
+
+    /// @brief Adds a sample to one of the heaps without making sure the median values are at the
+    /// heap roots
+    /// @param value 
+    void addSample(TValue value)
     {
         int count = getCount();
 
         if (count == maxSamples)
         {
             // we have reached the max number of samples. replace the value in the oldest sample
-            BinaryHeapNode<TValue>& nodeToUpdate = *samples[sampleIndex];
-            nodeToUpdate.heap->update(nodeToUpdate, value);
+            int handleToUpdate = samples[sampleIndex];
+            if (slab[handleToUpdate].heapId == maxHeap.getId())
+            {
+                maxHeap.update(handleToUpdate, value);
+            }
+            else
+            {
+                minHeap.update(handleToUpdate, value);
+            }
         }
         else
         {
@@ -421,68 +763,1067 @@ public:
             // the max heap one size larger to ensure the median value(s) are always stored in
             // the roots.
             bool isEven = (count % 2) == 0;
-            BinaryHeapNode<TValue>& node = isEven ? maxHeap.add(value) : minHeap.add(value);
-            samples.push_back(&node);
+            int handle = isEven ? maxHeap.add(value) : minHeap.add(value);
+            samples.push_back(handle);
         }
 
+        sampleIndex += 1;
+        sampleIndex %= maxSamples;
+    }
+
+    /// @brief Moves values between the heaps until every value in the max heap is less than or
+    /// equal to every value in the min heap
+    void balanceRoots()
+    {
         /*
         at this point, the min and max heaps both satisfy their heap property indepedently,
-        but, it's possible the heap we added/updated the value in wasnt the correct heap to
+        but, it's possible the heap we added/updated the value(s) in wasnt the correct heap to
         ensure the two middle values are at the heap roots. So swap the roots then fix up the
-        heaps again, if necessary.
+        heaps again until they are. After a single add, at most one swap is needed. After a
+        batch, one swap is needed per misplaced value.
         */
-        auto minHeapRoot = minHeap.getRoot();
-        auto maxHeapRoot = maxHeap.getRoot();
-        if ((minHeapRoot != nullptr) && (maxHeapRoot != nullptr))
+        if ((minHeap.size() > 0) && (maxHeap.size() > 0))
         {
             // min heap root value should be greater than max heap root value
-            if (minHeapRoot->value < maxHeapRoot->value)
+            while (minHeap.getRootValue() < maxHeap.getRootValue())
             {
                 minHeap.swapRoot(maxHeap);
             }
         }
-
-        sampleIndex += 1;
-        sampleIndex %= maxSamples;
     }
+};
 
-private:
-    // the heaps are declared before the samples vector so the samples vector is destroyed first.
-    // this isnt required but it's more correct because the samples vector contains pointers to
-    // nodes in the heaps.
-    BinaryHeap<TValue> maxHeap;
-    BinaryHeap<TValue> minHeap;
-    int maxSamples;
-    int sampleIndex;
-    std::vector<BinaryHeapNode<TValue>*> samples;
+template<typename TValue, typename TTimestamp = long long, typename TDuration = TTimestamp>
+class TimedMovingMedian {
+public:
+    // copy and move constructor and assignment not implemented
+    TimedMovingMedian(const TimedMovingMedian&)=delete;
+    TimedMovingMedian& operator=(const TimedMovingMedian&)=delete;
+    TimedMovingMedian(const TimedMovingMedian&&)=delete;
+    TimedMovingMedian& operator=(const TimedMovingMedian&&)=delete;
 
-    MovingMedian(int maxSamples, int maxHeapCapacity) :
-        maxHeap(true, std::max(1, maxHeapCapacity)),
-        minHeap(false, std::max(1, maxSamples - maxHeapCapacity)),
-        maxSamples{maxSamples},
-        sampleIndex{0},
-        samples{}
+    /// @brief Constructs a moving median calculator over the samples of the last window of
+    /// time, e.g. the last 30 days, rather than the last number of samples. Like MovingMedian it
+    /// combines a max heap of the lower half of the samples with a min heap of the upper half,
+    /// but samples leave whenever they age out, so any sample can be removed from either heap.
+    /// @param window Samples this old or older are evicted
+    /// @param maxSamples Maximum number of samples in the window at once. When it is reached the
+    /// oldest sample is evicted early.
+    TimedMovingMedian(TDuration window, int maxSamples) :
+        slab(std::max(1, maxSamples)),
+        // evictions can leave every sample in one heap until the next rebalance
+        maxHeap(std::max(1, maxSamples), slab),
+        minHeap(std::max(1, maxSamples), slab),
+        window{window},
+        samples{},
+        oldest{0},
+        count{0}
     {
         if (maxSamples < 1)
         {
             throw std::out_of_range("Max samples must be greater than 0");
         }
+
+        samples.resize(maxSamples);
     }
-};
 
-int activityNotifications(std::vector<int> expenditure, int d)
-{
-    int result = 0;
-    MovingMedian<int> medianCalculator{d};
+    /// @brief Returns current number of samples used in the median calculation
+    /// @return 
+    int getCount() const
+    {
+        return count;
+    }
 
-    for (auto curDaySpending : expenditure)
+    /// @brief Returns twice the median of the samples in the window as of the last add or
+    /// expire. If the number of samples is odd, the median value is the middle value, if the
+    /// number of samples is even, the median value is the average of the two middle values.
+    /// @return 
+    TValue getTwiceMedian() const
     {
-        if (medianCalculator.getCount() == d)
+        if (count == 0)
         {
-            if (curDaySpending >= medianCalculator.getTwiceMedian())
-            {
-                result++;
-            }
+            throw std::runtime_error("No samples yet!");
+        }
+
+        TValue lowMedian = maxHeap.getRootValue();
+        TValue highMedian = (maxHeap.size() == minHeap.size()) ? minHeap.getRootValue() : lowMedian;
+        return lowMedian + highMedian;
+    }
+
+    /// @brief Evicts the samples that have aged out of the window, then adds a sample
+    /// @param timestamp The time of the sample. Must not be earlier than the previous sample.
+    /// @param value 
+    void add(TTimestamp timestamp, TValue value)
+    {
+        if ((count > 0) && (timestamp < newest().timestamp))
+        {
+            throw std::invalid_argument("Samples must be added in timestamp order");
+        }
+
+        evict(timestamp, count == capacity());
+
+        // the lower half goes to the max heap. Evictions may have emptied either heap, so
+        // compare against whichever root is left; balanceSizes then evens out the sizes.
+        bool isUpperHalf = (maxHeap.size() > 0)
+            ? (maxHeap.getRootValue() < value)
+            : ((minHeap.size() > 0) && (minHeap.getRootValue() < value));
+        int handle = isUpperHalf ? minHeap.add(value) : maxHeap.add(value);
+        samples[(oldest + count) % capacity()] = TimedSample{timestamp, handle};
+        count++;
+
+        balanceSizes();
+    }
+
+    /// @brief Evicts the samples that have aged out of the window as of the given time, without
+    /// adding a sample
+    /// @param now 
+    void expire(TTimestamp now)
+    {
+        evict(now, false);
+        balanceSizes();
+    }
+
+private:
+    struct TimedSample
+    {
+        TTimestamp timestamp;
+        int handle;
+    };
+
+    BinaryHeapSlab<TValue> slab;
+    BinaryHeap<TValue, std::less<TValue>> maxHeap;
+    BinaryHeap<TValue, std::greater<TValue>> minHeap;
+    TDuration window;
+    // a ring of the samples in the window, oldest first
+    std::vector<TimedSample> samples;
+    int oldest;
+    int count;
+
+    int capacity() const
+    {
+        return samples.size();
+    }
+
+    const TimedSample& newest() const
+    {
+        return samples[(oldest + count - 1) % capacity()];
+    }
+
+    /// @brief Removes every sample that is at least a window older than now from its heap. Each
+    /// removal keeps its heap valid but may leave the heap sizes unbalanced, which is fixed
+    /// once for the whole burst by balanceSizes.
+    /// @param now 
+    /// @param makeRoom True to evict the oldest sample even if it is still in the window
+    void evict(TTimestamp now, bool makeRoom)
+    {
+        while ((count > 0) && (makeRoom || !(now < samples[oldest].timestamp + window)))
+        {
+            int handle = samples[oldest].handle;
+            if (slab[handle].heapId == maxHeap.getId())
+            {
+                maxHeap.remove(handle);
+            }
+            else
+            {
+                minHeap.remove(handle);
+            }
+
+            oldest = (oldest + 1) % capacity();
+            count--;
+            makeRoom = false;
+        }
+    }
+
+    /// @brief Moves roots between the heaps until the max heap holds as many samples as the min
+    /// heap or one more. Every value in the max heap stays less than or equal to every value in
+    /// the min heap, because only the root nearest the other heap ever moves.
+    void balanceSizes()
+    {
+        while (maxHeap.size() > minHeap.size() + 1)
+        {
+            maxHeap.transferRoot(minHeap);
+        }
+        while (minHeap.size() > maxHeap.size())
+        {
+            minHeap.transferRoot(maxHeap);
+        }
+    }
+};
+
+template<typename TValue, typename TTenant = long long>
+class MovingMedianPool {
+public:
+    // copy and move constructor and assignment not implemented
+    MovingMedianPool(const MovingMedianPool&)=delete;
+    MovingMedianPool& operator=(const MovingMedianPool&)=delete;
+    MovingMedianPool(const MovingMedianPool&&)=delete;
+    MovingMedianPool& operator=(const MovingMedianPool&&)=delete;
+
+    /// @brief Constructs a pool of moving median calculators, one per tenant, that all use the
+    /// same number of samples. A tenant costs nothing until its first sample. It then gets a
+    /// small block of samples that doubles as it fills, up to maxSamples. Blocks of the same
+    /// size share one slab, so no tenant owns an allocation of its own.
+    /// @param maxSamples Maximum number of samples to use in calculating each tenant's median
+    MovingMedianPool(int maxSamples) :
+        maxSamples{maxSamples},
+        slotByTenant{},
+        tenants{},
+        freeTenants{},
+        slabs{}
+    {
+        if (maxSamples < 1)
+        {
+            throw std::out_of_range("Max samples must be greater than 0");
+        }
+
+        for (int capacity = MinBlockSamples; ; capacity *= 2)
+        {
+            slabs.emplace_back();
+            slabs.back().capacity = std::min(capacity, maxSamples);
+            if (capacity >= maxSamples)
+            {
+                break;
+            }
+        }
+    }
+
+    /// @brief Returns the number of tenants with samples
+    /// @return 
+    int getTenantCount() const
+    {
+        return slotByTenant.size();
+    }
+
+    /// @brief Returns the current number of samples used in the tenant's median calculation
+    /// @param tenant 
+    /// @return 0 if the tenant has no samples
+    int getCount(TTenant tenant) const
+    {
+        auto found = slotByTenant.find(tenant);
+        return (found == slotByTenant.end()) ? 0 : tenants[found->second].count;
+    }
+
+    /// @brief Returns twice the tenant's current median value, like MovingMedian::getTwiceMedian
+    /// @param tenant 
+    /// @return 
+    TValue getTwiceMedian(TTenant tenant) const
+    {
+        auto found = slotByTenant.find(tenant);
+        if (found == slotByTenant.end())
+        {
+            throw std::runtime_error("No samples yet!");
+        }
+
+        // the max heap root is at the start of the block's heap array and the min heap root at
+        // its end
+        const TenantState& state = tenants[found->second];
+        const BlockSlab& slab = slabs[state.sizeClass];
+        size_t offset = static_cast<size_t>(state.block) * slab.capacity;
+        TValue lowMedian = slab.values[offset + slab.heap[offset]];
+        TValue highMedian = ((state.count % 2) == 0)
+            ? slab.values[offset + slab.heap[offset + slab.capacity - 1]]
+            : lowMedian;
+        return lowMedian + highMedian;
+    }
+
+    /// @brief Adds a sample to the tenant's moving median calculation
+    /// @param tenant 
+    /// @param value 
+    void add(TTenant tenant, TValue value)
+    {
+        // look up before inserting, emplace would allocate a node even for a known tenant
+        auto found = slotByTenant.find(tenant);
+        if (found == slotByTenant.end())
+        {
+            found = slotByTenant.emplace(tenant, allocateTenant()).first;
+        }
+
+        TenantState& state = tenants[found->second];
+        if (state.count == slabs[state.sizeClass].capacity && state.count < maxSamples)
+        {
+            grow(state);
+        }
+
+        Block block = getBlock(state.sizeClass, state.block);
+        int lowCount = (state.count / 2) + (state.count % 2);
+        if (state.count == maxSamples)
+        {
+            // the window is full. replace the value in the oldest sample and sift it within its
+            // heap
+            int slot = state.oldest;
+            int position = block.positions[slot];
+            bool isHigh = position >= lowCount;
+            int index = isHigh ? (block.capacity - 1 - position) : position;
+
+            TValue oldValue = block.values[slot];
+            block.values[slot] = value;
+            if (isBelow(isHigh, oldValue, value))
+            {
+                siftUp(block, isHigh, index);
+            }
+            else
+            {
+                siftDown(block, isHigh, index, isHigh ? (state.count - lowCount) : lowCount);
+            }
+
+            state.oldest = (state.oldest + 1) % maxSamples;
+        }
+        else
+        {
+            // the ring only wraps once it's full, so the next slot is the count. alternate
+            // between the heaps like MovingMedian does.
+            int slot = state.count;
+            bool isHigh = (state.count % 2) == 1;
+            int index = isHigh ? (state.count - lowCount) : lowCount;
+
+            block.values[slot] = value;
+            place(block, isHigh, index, slot);
+            siftUp(block, isHigh, index);
+            state.count++;
+        }
+
+        balanceRoots(block, state.count);
+    }
+
+    /// @brief Forgets every sample of the tenant, e.g. when an account goes inactive, and returns
+    /// its storage to the pool
+    /// @param tenant 
+    void release(TTenant tenant)
+    {
+        auto found = slotByTenant.find(tenant);
+        if (found == slotByTenant.end())
+        {
+            return;
+        }
+
+        TenantState& state = tenants[found->second];
+        slabs[state.sizeClass].freeBlocks.push_back(state.block);
+        freeTenants.push_back(found->second);
+        slotByTenant.erase(found);
+    }
+
+    /// @brief Returns an estimate of the memory used by the pool in bytes, including the hash map's
+    /// bucket array and one heap allocation per tenant for its node
+    /// @return 
+    size_t getMemoryUsage() const
+    {
+        // a hash map node holds the entry and a next pointer. the allocator adds a size header
+        // and rounds up to 16 bytes, with 32 bytes the smallest block it hands out.
+        size_t nodeSize = sizeof(void*) + sizeof(std::pair<const TTenant, int>);
+        size_t nodeAllocation = std::max<size_t>(32, (nodeSize + sizeof(size_t) + 15) / 16 * 16);
+        size_t result = slotByTenant.size() * nodeAllocation
+            + slotByTenant.bucket_count() * sizeof(void*)
+            + tenants.capacity() * sizeof(TenantState) + freeTenants.capacity() * sizeof(int);
+        for (const auto& slab : slabs)
+        {
+            result += slab.values.capacity() * sizeof(TValue) + slab.heap.capacity() * sizeof(int)
+                + slab.positions.capacity() * sizeof(int) + slab.freeBlocks.capacity() * sizeof(int);
+        }
+        return result;
+    }
+
+private:
+    static constexpr int MinBlockSamples = 1;
+
+    // the whole per tenant state, besides its hash map entry and samples
+    struct TenantState
+    {
+        int block;
+        int sizeClass;
+        int count;
+        int oldest;
+    };
+
+    // all blocks of one size class. each block is a ring of sample values, the two heaps of ring
+    // slots and the heap position of each ring slot. the max heap of the lower half grows from
+    // the start of a block's heap array and the min heap of the upper half grows from its end,
+    // so together they never need more than capacity entries.
+    struct BlockSlab
+    {
+        int capacity;
+        std::vector<TValue> values;
+        std::vector<int> heap;
+        std::vector<int> positions;
+        std::vector<int> freeBlocks;
+    };
+
+    // pointers into a block, only valid until a slab grows
+    struct Block
+    {
+        TValue* values;
+        int* heap;
+        int* positions;
+        int capacity;
+    };
+
+    int maxSamples;
+    std::unordered_map<TTenant, int> slotByTenant;
+    std::vector<TenantState> tenants;
+    std::vector<int> freeTenants;
+    std::vector<BlockSlab> slabs;
+
+    int allocateTenant()
+    {
+        int slot = tenants.size();
+        if (freeTenants.empty())
+        {
+            tenants.emplace_back();
+        }
+        else
+        {
+            slot = freeTenants.back();
+            freeTenants.pop_back();
+        }
+
+        tenants[slot] = TenantState{allocateBlock(0), 0, 0, 0};
+        return slot;
+    }
+
+    int allocateBlock(int sizeClass)
+    {
+        BlockSlab& slab = slabs[sizeClass];
+        if (!slab.freeBlocks.empty())
+        {
+            int block = slab.freeBlocks.back();
+            slab.freeBlocks.pop_back();
+            return block;
+        }
+
+        int block = slab.values.size() / slab.capacity;
+        slab.values.resize(slab.values.size() + slab.capacity);
+        slab.heap.resize(slab.heap.size() + slab.capacity);
+        slab.positions.resize(slab.positions.size() + slab.capacity);
+        return block;
+    }
+
+    Block getBlock(int sizeClass, int block)
+    {
+        BlockSlab& slab = slabs[sizeClass];
+        size_t offset = static_cast<size_t>(block) * slab.capacity;
+        return Block{slab.values.data() + offset, slab.heap.data() + offset, slab.positions.data() + offset, slab.capacity};
+    }
+
+    /// @brief Moves a tenant that filled its block to a block of the next size class. The ring
+    /// hasn't wrapped yet, so the samples keep their slots and only the min heap moves to the
+    /// end of the bigger block.
+    /// @param state 
+    void grow(TenantState& state)
+    {
+        int newBlock = allocateBlock(state.sizeClass + 1);
+        Block block = getBlock(state.sizeClass, state.block);
+        Block newBlockView = getBlock(state.sizeClass + 1, newBlock);
+
+        int lowCount = (state.count / 2) + (state.count % 2);
+        std::copy(block.values, block.values + state.count, newBlockView.values);
+        for (int i = 0; i < lowCount; i++)
+        {
+            place(newBlockView, false, i, block.heap[i]);
+        }
+        for (int i = 0; i < state.count - lowCount; i++)
+        {
+            place(newBlockView, true, i, block.heap[block.capacity - 1 - i]);
+        }
+
+        slabs[state.sizeClass].freeBlocks.push_back(state.block);
+        state.block = newBlock;
+        state.sizeClass++;
+    }
+
+    /// @brief Returns true if value belongs below otherValue in the max heap, or in the min heap
+    /// if isHigh
+    static bool isBelow(bool isHigh, const TValue& value, const TValue& otherValue)
+    {
+        return isHigh ? (otherValue < value) : (value < otherValue);
+    }
+
+    static int& entry(const Block& block, bool isHigh, int index)
+    {
+        return block.heap[isHigh ? (block.capacity - 1 - index) : index];
+    }
+
+    static void place(const Block& block, bool isHigh, int index, int slot)
+    {
+        int position = isHigh ? (block.capacity - 1 - index) : index;
+        block.heap[position] = slot;
+        block.positions[slot] = position;
+    }
+
+    static void siftUp(const Block& block, bool isHigh, int index)
+    {
+        int slot = entry(block, isHigh, index);
+        while (index > 0)
+        {
+            int parent = (index - 1) / 2;
+            int parentSlot = entry(block, isHigh, parent);
+            if (!isBelow(isHigh, block.values[parentSlot], block.values[slot]))
+            {
+                break;
+            }
+
+            place(block, isHigh, index, parentSlot);
+            index = parent;
+        }
+        place(block, isHigh, index, slot);
+    }
+
+    static void siftDown(const Block& block, bool isHigh, int index, int size)
+    {
+        int slot = entry(block, isHigh, index);
+        while (true)
+        {
+            int child = (2 * index) + 1;
+            if (child >= size)
+            {
+                break;
+            }
+
+            if ((child + 1 < size)
+                && isBelow(isHigh, block.values[entry(block, isHigh, child)], block.values[entry(block, isHigh, child + 1)]))
+            {
+                child++;
+            }
+
+            int childSlot = entry(block, isHigh, child);
+            if (!isBelow(isHigh, block.values[slot], block.values[childSlot]))
+            {
+                break;
+            }
+
+            place(block, isHigh, index, childSlot);
+            index = child;
+        }
+        place(block, isHigh, index, slot);
+    }
+
+    /// @brief Swaps the heap roots until every value in the max heap is less than or equal to
+    /// every value in the min heap, like MovingMedian::balanceRoots
+    /// @param block 
+    /// @param count 
+    static void balanceRoots(const Block& block, int count)
+    {
+        int lowCount = (count / 2) + (count % 2);
+        int highCount = count - lowCount;
+        if (highCount == 0)
+        {
+            return;
+        }
+
+        while (block.values[entry(block, true, 0)] < block.values[entry(block, false, 0)])
+        {
+            int lowSlot = entry(block, false, 0);
+            place(block, false, 0, entry(block, true, 0));
+            place(block, true, 0, lowSlot);
+            siftDown(block, false, 0, lowCount);
+            siftDown(block, true, 0, highCount);
+        }
+    }
+};
+
+template<typename TValue>
+class OrderStatisticTree {
+public:
+    /// @brief The handle used for missing children
+    static constexpr int NoNode = -1;
+
+    // copy and move constructor and assignment not implemented
+    OrderStatisticTree(const OrderStatisticTree&)=delete;
+    OrderStatisticTree& operator=(const OrderStatisticTree&)=delete;
+    OrderStatisticTree(const OrderStatisticTree&&)=delete;
+    OrderStatisticTree& operator=(const OrderStatisticTree&&)=delete;
+
+    /// @brief Constructs an order statistic tree, a treap where every node also stores the size of
+    /// its subtree so the k-th smallest value can be found in logarithmic time. Like the binary
+    /// heap, nodes live in one contiguous vector and are referred to by handle.
+    /// @param capacity The maximum number of values to store in the tree
+    OrderStatisticTree(int capacity) :
+        nodes{},
+        root{NoNode},
+        seed{0x9e3779b9u}
+    {
+        if (capacity < 1)
+        {
+            throw std::out_of_range("Capacity must be greater than 0");
+        }
+
+        nodes.reserve(capacity);
+    }
+
+    /// @brief Returns the number of values currently in the tree
+    /// @return 
+    int size() const
+    {
+        return getSize(root);
+    }
+
+    /// @brief Returns the maximum number of values that can be in the tree
+    /// @return 
+    int capacity() const
+    {
+        return nodes.capacity();
+    }
+
+    /// @brief Adds a new value to the tree
+    /// @param value The value to add
+    /// @return The handle of the new node
+    int add(TValue value)
+    {
+        int count = nodes.size();
+        if (count == capacity())
+        {
+            throw std::runtime_error("Tree is full!");
+        }
+
+        nodes.push_back({value, NoNode, NoNode, 1, nextPriority()});
+        insert(count);
+
+        return count;
+    }
+
+    /// @brief Updates the value in the specified node by unlinking it and linking it back in at
+    /// its new position. The handle stays the same.
+    /// @param handle The handle of the node to update
+    /// @param value The new value
+    void update(int handle, TValue value)
+    {
+        root = erase(root, handle);
+
+        TreeNode& node = nodes[handle];
+        node.value = value;
+        node.left = NoNode;
+        node.right = NoNode;
+        node.size = 1;
+        insert(handle);
+    }
+
+    /// @brief Returns the k-th smallest value in the tree
+    /// @param k Zero based rank of the value, must be less than size()
+    /// @return 
+    TValue getKth(int k) const
+    {
+        if ((k < 0) || (k >= size()))
+        {
+            throw std::out_of_range("Rank must be within the number of values in the tree");
+        }
+
+        int current = root;
+        while (true)
+        {
+            const TreeNode& node = nodes[current];
+            int leftSize = getSize(node.left);
+            if (k < leftSize)
+            {
+                current = node.left;
+            }
+            else if (k == leftSize)
+            {
+                return node.value;
+            }
+            else
+            {
+                k -= leftSize + 1;
+                current = node.right;
+            }
+        }
+    }
+
+private:
+    struct TreeNode {
+        TValue value;
+        int left;
+        int right;
+        int size;
+        unsigned int priority;
+    };
+
+    std::vector<TreeNode> nodes;
+    int root;
+    unsigned int seed;
+
+    /// @brief Returns a pseudo random priority for a new node (xorshift32)
+    /// @return 
+    unsigned int nextPriority()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    int getSize(int handle) const
+    {
+        return (handle == NoNode) ? 0 : nodes[handle].size;
+    }
+
+    void updateSize(int handle)
+    {
+        TreeNode& node = nodes[handle];
+        node.size = 1 + getSize(node.left) + getSize(node.right);
+    }
+
+    /// @brief Indicates if the first node sorts before the second. Equal values are ordered by
+    /// handle so every node has a unique position and can be found again when erased.
+    /// @param handle 
+    /// @param otherHandle 
+    /// @return 
+    bool isBefore(int handle, int otherHandle) const
+    {
+        const TValue& value = nodes[handle].value;
+        const TValue& otherValue = nodes[otherHandle].value;
+        return (value < otherValue) || (!(otherValue < value) && (handle < otherHandle));
+    }
+
+    /// @brief Links a detached node into the tree
+    /// @param handle 
+    void insert(int handle)
+    {
+        int left = NoNode;
+        int right = NoNode;
+        split(root, handle, left, right);
+        root = merge(merge(left, handle), right);
+    }
+
+    /// @brief Splits a subtree into the nodes sorting before the specified node and the rest
+    /// @param subtree The root of the subtree to split
+    /// @param handle The node to split around
+    /// @param left Receives the root of the nodes sorting before the specified node
+    /// @param right Receives the root of the remaining nodes
+    void split(int subtree, int handle, int& left, int& right)
+    {
+        if (subtree == NoNode)
+        {
+            left = NoNode;
+            right = NoNode;
+        }
+        else if (isBefore(subtree, handle))
+        {
+            split(nodes[subtree].right, handle, nodes[subtree].right, right);
+            left = subtree;
+            updateSize(subtree);
+        }
+        else
+        {
+            split(nodes[subtree].left, handle, left, nodes[subtree].left);
+            right = subtree;
+            updateSize(subtree);
+        }
+    }
+
+    /// @brief Merges two subtrees where every node in the left subtree sorts before every node in
+    /// the right subtree
+    /// @param left 
+    /// @param right 
+    /// @return The root of the merged subtree
+    int merge(int left, int right)
+    {
+        int result = NoNode;
+
+        if (left == NoNode)
+        {
+            result = right;
+        }
+        else if (right == NoNode)
+        {
+            result = left;
+        }
+        else if (nodes[left].priority > nodes[right].priority)
+        {
+            nodes[left].right = merge(nodes[left].right, right);
+            updateSize(left);
+            result = left;
+        }
+        else
+        {
+            nodes[right].left = merge(left, nodes[right].left);
+            updateSize(right);
+            result = right;
+        }
+
+        return result;
+    }
+
+    /// @brief Unlinks a node from a subtree
+    /// @param subtree The root of the subtree containing the node
+    /// @param handle The node to unlink
+    /// @return The new root of the subtree
+    int erase(int subtree, int handle)
+    {
+        int result = subtree;
+
+        if (subtree == handle)
+        {
+            result = merge(nodes[subtree].left, nodes[subtree].right);
+        }
+        else
+        {
+            if (isBefore(handle, subtree))
+            {
+                nodes[subtree].left = erase(nodes[subtree].left, handle);
+            }
+            else
+            {
+                nodes[subtree].right = erase(nodes[subtree].right, handle);
+            }
+            updateSize(subtree);
+        }
+
+        return result;
+    }
+};
+
+template<typename TValue>
+class MovingQuantile {
+public:
+    /// @brief Constructs an instance of a moving quantile calculator. Samples are kept in an
+    /// order statistic tree so any quantile of the window can be found in logarithmic time.
+    /// Samples are added with the same ring buffer semantics as MovingMedian.
+    /// @param maxSamples Maximum number of samples to use in calculating quantiles
+    MovingQuantile(int maxSamples) :
+        tree(std::max(1, maxSamples)),
+        maxSamples{maxSamples},
+        sampleIndex{0}
+    {
+        if (maxSamples < 1)
+        {
+            throw std::out_of_range("Max samples must be greater than 0");
+        }
+    }
+
+    /// @brief Returns current number of samples used in the quantile calculation
+    /// @return 
+    int getCount() const
+    {
+        return tree.size();
+    }
+
+    /// @brief Returns the k-th smallest sample in the window
+    /// @param k Zero based rank, must be less than getCount()
+    /// @return 
+    TValue getKth(int k) const
+    {
+        return tree.getKth(k);
+    }
+
+    /// @brief Returns the requested quantile of the samples using the nearest rank method, i.e.
+    /// the smallest sample that is greater than or equal to the given fraction of the samples.
+    /// @param quantile The quantile, between 0 and 1. For example 0.99 for p99.
+    /// @return 
+    TValue getQuantile(double quantile) const
+    {
+        int count = getCount();
+        if (count == 0)
+        {
+            throw std::runtime_error("No samples yet!");
+        }
+        if ((quantile < 0.0) || (quantile > 1.0))
+        {
+            throw std::out_of_range("Quantile must be between 0 and 1");
+        }
+
+        // the nearest rank is the smallest rank with rank / count >= quantile. quantile * count
+        // can round up past a whole number, e.g. 0.07 * 100 is 7.000000000000001, so step back
+        // when the rank below already reaches the quantile.
+        int rank = static_cast<int>(std::ceil(quantile * count));
+        if ((rank > 1) && (static_cast<double>(rank - 1) / count >= quantile))
+        {
+            rank--;
+        }
+        return tree.getKth(std::max(1, rank) - 1);
+    }
+
+    /// @brief Returns twice the current median value, matching MovingMedian::getTwiceMedian
+    /// @return 
+    int getTwiceMedian() const
+    {
+        int count = getCount();
+        if (count == 0)
+        {
+            throw std::runtime_error("No samples yet!");
+        }
+
+        int low_median = tree.getKth((count - 1) / 2);
+        int high_median = tree.getKth(count / 2);
+
+        return low_median + high_median;
+    }
+
+    /// @brief Add a sample to the moving quantile calculation
+    /// @param value 
+    void add(TValue value)
+    {
+        // tree nodes are allocated in ring order, so the handle of the sample in each ring slot
+        // is the slot index itself.
+        if (getCount() == maxSamples)
+        {
+            // we have reached the max number of samples. replace the value in the oldest sample
+            tree.update(sampleIndex, value);
+        }
+        else
+        {
+            tree.add(value);
+        }
+
+        sampleIndex += 1;
+        sampleIndex %= maxSamples;
+    }
+
+private:
+    OrderStatisticTree<TValue> tree;
+    int maxSamples;
+    int sampleIndex;
+};
+
+template<typename TValue, int MaxValue>
+class BoundedMovingMedian {
+public:
+    static_assert(std::is_integral<TValue>::value, "Bounded moving median requires integer samples");
+    static_assert(MaxValue >= 0, "Max value must not be negative");
+
+    /// @brief Constructs an instance of a moving median calculator for samples known, at compile
+    /// time, to be in the range [0, MaxValue]. A frequency histogram over the whole range is kept
+    /// in a Fenwick tree so samples are added and the median is found in O(log MaxValue) time
+    /// regardless of the number of samples.
+    /// @param maxSamples Maximum number of samples to use in calculating the median
+    BoundedMovingMedian(int maxSamples) :
+        counts{},
+        maxSamples{maxSamples},
+        sampleIndex{0},
+        samples{}
+    {
+        if (maxSamples < 1)
+        {
+            throw std::out_of_range("Max samples must be greater than 0");
+        }
+
+        samples.reserve(maxSamples);
+    }
+
+    /// @brief Returns current number of samples used in the median calculation
+    /// @return 
+    int getCount() const
+    {
+        return samples.size();
+    }
+
+    /// @brief Returns twice the current median value. If the current number of samples is odd,
+    /// the median value is the middle value, if the current number of samples is even, the
+    /// median value is the average of the two middle values.
+    /// @return 
+    int getTwiceMedian() const
+    {
+        int count = getCount();
+        if (count == 0)
+        {
+            throw std::runtime_error("No samples yet!");
+        }
+
+        int low_median = getKth(((count - 1) / 2) + 1);
+        int high_median = low_median;
+        if ((count % 2) == 0)
+        {
+            high_median = getKth((count / 2) + 1);
+        }
+
+        return low_median + high_median;
+    }
+
+    /// @brief Add a sample to the moving median calculation
+    /// @param value A value between 0 and MaxValue
+    void add(TValue value)
+    {
+        if ((value < 0) || (value > MaxValue))
+        {
+            throw std::out_of_range("Sample is outside the bounded range");
+        }
+
+        if (getCount() == maxSamples)
+        {
+            // we have reached the max number of samples. replace the value in the oldest sample
+            TValue& sample = samples[sampleIndex];
+            addCount(sample, -1);
+            sample = value;
+        }
+        else
+        {
+            samples.push_back(value);
+        }
+        addCount(value, 1);
+
+        sampleIndex += 1;
+        sampleIndex %= maxSamples;
+    }
+
+private:
+    static constexpr int TreeSize = MaxValue + 1;
+
+    /// @brief Fenwick tree of sample counts. Entry i (1 based) holds the number of samples with
+    /// a value in (i - lowbit(i), i], shifted down by one.
+    std::array<int, TreeSize + 1> counts;
+    int maxSamples;
+    int sampleIndex;
+    std::vector<TValue> samples;
+
+    /// @brief Returns the largest power of two that is not greater than the tree size
+    /// @return 
+    static constexpr int getHighestStep()
+    {
+        int step = 1;
+        while ((step * 2) <= TreeSize)
+        {
+            step *= 2;
+        }
+        return step;
+    }
+
+    /// @brief Adds to the count of samples with the specified value
+    /// @param value 
+    /// @param delta 
+    void addCount(TValue value, int delta)
+    {
+        for (int i = value + 1; i <= TreeSize; i += (i & -i))
+        {
+            counts[i] += delta;
+        }
+    }
+
+    /// @brief Returns the k-th smallest sample by descending the Fenwick tree one power of two
+    /// at a time
+    /// @param k One based rank of the sample
+    /// @return 
+    int getKth(int k) const
+    {
+        int position = 0;
+        for (int step = getHighestStep(); step > 0; step /= 2)
+        {
+            int next = position + step;
+            if ((next <= TreeSize) && (counts[next] < k))
+            {
+                position = next;
+                k -= counts[next];
+            }
+        }
+
+        // position is the number of values whose cumulative count is below k, i.e. the value
+        return position;
+    }
+};
+
+// the problem guarantees expenditures are between 0 and 200
+constexpr int MaxExpenditure = 200;
+
+template<typename TMedianCalculator>
+int countNotifications(const std::vector<int>& expenditure, int d)
+{
+    int result = 0;
+    TMedianCalculator medianCalculator{d};
+
+    for (auto curDaySpending : expenditure)
+    {
+        if (medianCalculator.getCount() == d)
+        {
+            if (curDaySpending >= medianCalculator.getTwiceMedian())
+            {
+                result++;
+            }
         }
         medianCalculator.add(curDaySpending);
     }
@@ -490,7 +1831,480 @@ int activityNotifications(std::vector<int> expenditure, int d)
     return result;
 }
 
+/// @brief Counts the notifications using the histogram based median, for expenditures the caller
+/// knows are between 0 and MaxValue. Callers without such a bound use
+/// countNotifications<MovingMedian<int>>, whose heap based median works for any value.
+/// @tparam MaxValue The largest possible expenditure
+/// @param expenditure 
+/// @param d The number of trailing days the median is taken over
+/// @return 
+template<int MaxValue>
+int activityNotifications(std::vector<int> expenditure, int d)
+{
+    return countNotifications<BoundedMovingMedian<int, MaxValue>>(expenditure, d);
+}
+
+int activityNotifications(std::vector<int> expenditure, int d)
+{
+    return activityNotifications<MaxExpenditure>(expenditure, d);
+}
+
+#ifdef BENCHMARK
+
+// Benchmark harness, build with -DBENCHMARK. Every benchmark reports the time per operation,
+// throughput and the number of heap allocations per operation.
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+
+static std::atomic<long long> allocationCount{0};
+
+// replace the global allocation functions to count allocations. they are kept out of line so the
+// compiler doesn't pair the inlined malloc() and free() calls with new and delete and warn.
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* result = std::malloc((size > 0) ? size : 1);
+    if (result == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+enum class Distribution {
+    Uniform,
+    Sorted,
+    Adversarial,
+    Zipf
+};
+
+static Distribution parseDistribution(const char* name)
+{
+    Distribution result = Distribution::Uniform;
+
+    if (std::strcmp(name, "sorted") == 0)
+    {
+        result = Distribution::Sorted;
+    }
+    else if (std::strcmp(name, "adversarial") == 0)
+    {
+        result = Distribution::Adversarial;
+    }
+    else if (std::strcmp(name, "zipf") == 0)
+    {
+        result = Distribution::Zipf;
+    }
+    else if (std::strcmp(name, "uniform") != 0)
+    {
+        throw std::invalid_argument("Distribution must be uniform, sorted, adversarial or zipf");
+    }
+
+    return result;
+}
+
+/// @brief Generates benchmark input values between 0 and maxValue
+/// @param count The number of values to generate
+/// @param distribution uniform random, sorted ascending, adversarial (alternates between the
+/// extremes so every value lands on the other side of the median) or zipf (value k is picked
+/// with a probability proportional to 1 / (k + 1))
+/// @param maxValue The largest value to generate
+/// @return 
+static std::vector<int> generateValues(int count, Distribution distribution, int maxValue)
+{
+    std::vector<int> result(count);
+    std::mt19937 generator{12345};
+
+    switch (distribution)
+    {
+    case Distribution::Uniform:
+        {
+            std::uniform_int_distribution<int> uniform{0, maxValue};
+            for (auto& value : result)
+            {
+                value = uniform(generator);
+            }
+        }
+        break;
+    case Distribution::Sorted:
+        for (int i = 0; i < count; i++)
+        {
+            result[i] = static_cast<int>((static_cast<long long>(i) * maxValue) / std::max(1, count - 1));
+        }
+        break;
+    case Distribution::Adversarial:
+        for (int i = 0; i < count; i++)
+        {
+            int offset = (i / 2) % (maxValue + 1);
+            result[i] = ((i % 2) == 0) ? (maxValue - offset) : offset;
+        }
+        break;
+    case Distribution::Zipf:
+        {
+            std::vector<double> weights(maxValue + 1);
+            for (int k = 0; k <= maxValue; k++)
+            {
+                weights[k] = 1.0 / (k + 1);
+            }
+            std::discrete_distribution<int> zipf{weights.begin(), weights.end()};
+            for (auto& value : result)
+            {
+                value = zipf(generator);
+            }
+        }
+        break;
+    }
+
+    return result;
+}
+
+/// @brief Stops the compiler from optimizing away benchmark results
+static volatile long long benchmarkSink = 0;
+
+/// @brief Runs a benchmark once and prints ns/op, throughput and allocations/op
+/// @param name The name of the benchmark
+/// @param operations The number of operations performed by the benchmark body
+/// @param body The code to measure
+template<typename TBody>
+static void runBenchmark(const char* name, long long operations, TBody&& body)
+{
+    long long allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+
+    body();
+
+    auto end = std::chrono::steady_clock::now();
+    long long allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+    double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+    double ops = static_cast<double>(std::max(1LL, operations));
+
+    std::printf("%-40s %10.2f ns/op %10.2f Mops/s %8.3f allocs/op\n",
+        name,
+        nanoseconds / ops,
+        (ops * 1000.0) / std::max(1.0, nanoseconds),
+        allocations / ops);
+}
+
+/// @brief Benchmarks filling a max heap of the given arity and then updating random nodes in it
+/// @param heapSize The number of values in the heap
+/// @param updates The number of updates to time
+/// @param values At least heapSize + updates random values
+template<int Arity>
+static void benchmarkHeapArity(int heapSize, int updates, const std::vector<int>& values)
+{
+    BinaryHeap<int, std::less<int>, Arity> heap(heapSize);
+    std::vector<int> handles(heapSize);
+    char name[64];
+
+    std::snprintf(name, sizeof(name), "BinaryHeap<%d-ary>::add n=%d", Arity, heapSize);
+    runBenchmark(name, heapSize, [&]() {
+        for (int i = 0; i < heapSize; i++)
+        {
+            handles[i] = heap.add(values[i]);
+        }
+        benchmarkSink = heap.getRootValue();
+    });
+
+    std::snprintf(name, sizeof(name), "BinaryHeap<%d-ary>::update n=%d", Arity, heapSize);
+    runBenchmark(name, updates, [&]() {
+        for (int i = 0; i < updates; i++)
+        {
+            // the handle is picked by value so successive updates land all over the heap
+            heap.update(handles[values[heapSize + i] % heapSize], values[i]);
+        }
+        benchmarkSink = heap.getRootValue();
+    });
+}
+
+int main(int argc, char* argv[])
+{
+    // usage: MovingMedian [samples] [window] [uniform|sorted|adversarial|zipf] [max value] [max heap size] [tenants]
+    int count = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    int window = (argc > 2) ? std::atoi(argv[2]) : 10000;
+    Distribution distribution = (argc > 3) ? parseDistribution(argv[3]) : Distribution::Uniform;
+    int maxValue = (argc > 4) ? std::atoi(argv[4]) : MaxExpenditure;
+    int maxHeapSize = (argc > 5) ? std::atoi(argv[5]) : 10000000;
+    int tenantCount = (argc > 6) ? std::atoi(argv[6]) : 100000;
+    if ((count < 1) || (window < 2) || (maxValue < 0) || (tenantCount < 1))
+    {
+        throw std::out_of_range("Samples must be at least 1, window at least 2, max value not negative and tenants at least 1");
+    }
+
+    std::vector<int> values = generateValues(count, distribution, maxValue);
+    std::printf("samples=%d window=%d max value=%d\n", count, window, maxValue);
+
+    runBenchmark("BinaryHeap::add", count, [&]() {
+        BinaryHeap<int, std::less<int>> heap(count);
+        for (auto value : values)
+        {
+            heap.add(value);
+        }
+        benchmarkSink = heap.getRootValue();
+    });
+
+    runBenchmark("BinaryHeap::build", count, [&]() {
+        BinaryHeap<int, std::less<int>> heap(count);
+        std::vector<int> handles(count);
+        heap.build(values.begin(), values.end(), handles.begin());
+        benchmarkSink = heap.getRootValue();
+    });
+
+    {
+        // warming up a window after a restart, one sample at a time against all at once
+        int primed = std::min(count, window);
+        runBenchmark("MovingMedian::add (warm up)", primed, [&]() {
+            MovingMedian<int> median(window);
+            for (int i = 0; i < primed; i++)
+            {
+                median.add(values[i]);
+            }
+            benchmarkSink = median.getTwiceMedian();
+        });
+
+        runBenchmark("MovingMedian::prime", primed, [&]() {
+            MovingMedian<int> median(window);
+            median.prime(values.begin(), values.begin() + primed);
+            benchmarkSink = median.getTwiceMedian();
+        });
+    }
+
+    {
+        BinaryHeap<int, std::less<int>> heap(window);
+        std::vector<int> handles;
+        for (int i = 0; i < window; i++)
+        {
+            handles.push_back(heap.add(values[i % count]));
+        }
+
+        runBenchmark("BinaryHeap::update", count, [&]() {
+            for (int i = 0; i < count; i++)
+            {
+                heap.update(handles[i % window], values[i]);
+            }
+            benchmarkSink = heap.getRootValue();
+        });
+    }
+
+    {
+        // a keyed record ordered by a comparator on its key
+        struct Order
+        {
+            int price;
+            long long id;
+        };
+        auto byPrice = [](const Order& first, const Order& second) { return first.price < second.price; };
+
+        BinaryHeap<Order, decltype(byPrice)> heap(window, byPrice);
+        std::vector<int> handles;
+        for (int i = 0; i < window; i++)
+        {
+            handles.push_back(heap.add(Order{values[i % count], i}));
+        }
+
+        runBenchmark("BinaryHeap::update (keyed record)", count, [&]() {
+            for (int i = 0; i < count; i++)
+            {
+                heap.update(handles[i % window], Order{values[i], i});
+            }
+            benchmarkSink = heap.getRootValue().id;
+        });
+    }
+
+    {
+        BinaryHeapSlab<int> slab(window);
+        BinaryHeap<int, std::less<int>> maxHeap(window / 2, slab);
+        BinaryHeap<int, std::greater<int>> minHeap(window / 2, slab);
+        for (int i = 0; i < (window / 2); i++)
+        {
+            maxHeap.add(values[i % count]);
+            minHeap.add(values[(i + (window / 2)) % count]);
+        }
+
+        runBenchmark("BinaryHeap::swapRoot", count, [&]() {
+            for (int i = 0; i < count; i++)
+            {
+                maxHeap.swapRoot(minHeap);
+            }
+            benchmarkSink = maxHeap.getRootValue();
+        });
+    }
+
+    {
+        MovingMedian<int> median(window);
+        runBenchmark("MovingMedian::add", count, [&]() {
+            for (auto value : values)
+            {
+                median.add(value);
+            }
+        });
+
+        runBenchmark("MovingMedian::getTwiceMedian", count, [&]() {
+            long long sum = 0;
+            for (int i = 0; i < count; i++)
+            {
+                sum += median.getTwiceMedian();
+            }
+            benchmarkSink = sum;
+        });
+    }
+
+    {
+        // irregular timestamps: mostly one tick apart, with bursts of samples on the same tick
+        // and idle gaps that expire a large part of the window at once
+        std::mt19937 generator(7);
+        std::vector<long long> timestamps(count);
+        long long timestamp = 0;
+        for (auto& sampleTime : timestamps)
+        {
+            unsigned roll = generator() % 1000;
+            timestamp += (roll < 100) ? 0 : (roll < 999) ? 1 : (window / 2);
+            sampleTime = timestamp;
+        }
+
+        TimedMovingMedian<int> median(window, 2 * window);
+        runBenchmark("TimedMovingMedian::add (irregular)", count, [&]() {
+            for (int i = 0; i < count; i++)
+            {
+                median.add(timestamps[i], values[i]);
+            }
+            benchmarkSink = median.getTwiceMedian();
+        });
+    }
+
+    {
+        // the samples are spread over many tenants, mostly over a few active ones
+        std::mt19937 generator(11);
+        std::vector<int> tenantIds(count);
+        for (auto& tenant : tenantIds)
+        {
+            tenant = ((generator() % 4) == 0) ? (generator() % tenantCount) : (generator() % std::max(1, tenantCount / 100));
+        }
+
+        MovingMedianPool<int, int> pool(window);
+        runBenchmark("MovingMedianPool::add", count, [&]() {
+            for (int i = 0; i < count; i++)
+            {
+                pool.add(tenantIds[i], values[i]);
+            }
+            benchmarkSink = pool.getTwiceMedian(tenantIds[0]);
+        });
+
+        long long heldSamples = 0;
+        for (int tenant = 0; tenant < tenantCount; tenant++)
+        {
+            heldSamples += pool.getCount(tenant);
+        }
+        double tenants = pool.getTenantCount();
+        std::printf("%-40s %9.0f tenants %8.1f bytes/tenant %8.1f of them sample values\n", "MovingMedianPool memory",
+            tenants,
+            pool.getMemoryUsage() / tenants,
+            (heldSamples * sizeof(int)) / tenants);
+    }
+
+    runBenchmark("MovingMedian::addBatch (4096)", count, [&]() {
+        MovingMedian<int> median(window);
+        for (int i = 0; i < count; i += 4096)
+        {
+            auto first = values.begin() + i;
+            median.addBatch(first, first + std::min(4096, count - i));
+        }
+        benchmarkSink = median.getTwiceMedian();
+    });
+
+    {
+        // nearest rank quantiles of 1..100 are the quantile times 100, including ones like 0.07
+        // whose product with 100 rounds up past a whole number
+        MovingQuantile<int> quantile(100);
+        for (int value = 1; value <= 100; value++)
+        {
+            quantile.add(value);
+        }
+        for (int percent : {1, 7, 29, 50, 57, 99, 100})
+        {
+            if (quantile.getQuantile(percent / 100.0) != percent)
+            {
+                throw std::runtime_error("MovingQuantile::getQuantile returned the wrong rank!");
+            }
+        }
+    }
+
+    {
+        MovingQuantile<int> quantile(window);
+        runBenchmark("MovingQuantile::add", count, [&]() {
+            for (auto value : values)
+            {
+                quantile.add(value);
+            }
+        });
+
+        runBenchmark("MovingQuantile::getQuantile (p99)", count, [&]() {
+            long long sum = 0;
+            for (int i = 0; i < count; i++)
+            {
+                sum += quantile.getQuantile(0.99);
+            }
+            benchmarkSink = sum;
+        });
+    }
+
+    if (maxValue <= MaxExpenditure)
+    {
+        runBenchmark("BoundedMovingMedian::add", count, [&]() {
+            BoundedMovingMedian<int, MaxExpenditure> median(window);
+            for (auto value : values)
+            {
+                median.add(value);
+            }
+            benchmarkSink = median.getTwiceMedian();
+        });
+    }
+
+    if (maxValue <= MaxExpenditure)
+    {
+        runBenchmark("activityNotifications", count, [&]() {
+            benchmarkSink = activityNotifications(values, window);
+        });
+    }
+
+    runBenchmark("countNotifications (heap median)", count, [&]() {
+        benchmarkSink = countNotifications<MovingMedian<int>>(values, window);
+    });
+
+    // binary against 4-ary and 8-ary heaps from cache resident sizes up to sizes where every
+    // level of a sift down misses the cache
+    constexpr int ArityUpdates = 1000000;
+    for (long long heapSize = 1000; heapSize <= maxHeapSize; heapSize *= 10)
+    {
+        std::vector<int> heapValues = generateValues(heapSize + ArityUpdates, Distribution::Uniform, INT_MAX);
+        benchmarkHeapArity<2>(heapSize, ArityUpdates, heapValues);
+        benchmarkHeapArity<4>(heapSize, ArityUpdates, heapValues);
+        benchmarkHeapArity<8>(heapSize, ArityUpdates, heapValues);
+    }
+
+    return 0;
+}
+
+#else
+
 int main(void)
 {
     return 0;
 }
+
+#endif
\ No newline at end of file
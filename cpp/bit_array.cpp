@@ -1,18 +1,1067 @@
 // Solves: https://www.hackerrank.com/challenges/bitset-1/problem?isFullScreen=true
 
-#include <bitset>
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <iterator>
 #include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
 #define MOD (2147483648)  // 2^31
 
-// a bitarray where each position indicates if that number
-// appeared in the sequence "a".
-// big array so make it a static variable instead of allocating on the stack
-// which also has the added bonus of initializing each bit to 0
-static bitset<MOD> numbersSeen;
+/// @brief Counts the set bits in an array of words one word at a time
+/// @param words
+/// @param count The number of words
+/// @return
+static long long popcount_scalar(const uint64_t* words, size_t count)
+{
+    long long result = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        result += __builtin_popcountll(words[i]);
+    }
+    return result;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/// @brief Counts the set bits in an array of words using the popcnt instruction
+__attribute__((target("popcnt")))
+static long long popcount_popcnt(const uint64_t* words, size_t count)
+{
+    long long result = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        result += __builtin_popcountll(words[i]);
+    }
+    return result;
+}
+
+/// @brief Counts the set bits in an array of words with AVX2, looking up the bit count of each
+/// nibble with a byte shuffle and summing the bytes with sad. count must be a multiple of 4.
+__attribute__((target("avx2")))
+static long long popcount_avx2(const uint64_t* words, size_t count)
+{
+    const __m256i nibbleCounts = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowNibbles = _mm256_set1_epi8(0x0f);
+    __m256i total = _mm256_setzero_si256();
+
+    for (size_t i = 0; i < count; i += 4)
+    {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+        __m256i low = _mm256_and_si256(block, lowNibbles);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(block, 4), lowNibbles);
+        __m256i bytes = _mm256_add_epi8(
+            _mm256_shuffle_epi8(nibbleCounts, low),
+            _mm256_shuffle_epi8(nibbleCounts, high));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+
+    return _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1)
+        + _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3);
+}
+
+/// @brief Counts the set bits in an array of words with the AVX-512 vector popcount instruction.
+/// count must be a multiple of 8.
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static long long popcount_avx512(const uint64_t* words, size_t count)
+{
+    __m512i total = _mm512_setzero_si512();
+
+    for (size_t i = 0; i < count; i += 8)
+    {
+        __m512i block = _mm512_loadu_si512(words + i);
+        total = _mm512_add_epi64(total, _mm512_popcnt_epi64(block));
+    }
+
+    long long lanes[8];
+    _mm512_storeu_si512(lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+}
+
+#endif
+
+/// @brief Returns the fastest popcount kernel the CPU supports
+/// @return
+static long long (*select_popcount())(const uint64_t*, size_t)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vpopcntdq"))
+    {
+        return popcount_avx512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return popcount_avx2;
+    }
+    if (__builtin_cpu_supports("popcnt"))
+    {
+        return popcount_popcnt;
+    }
+#endif
+    return popcount_scalar;
+}
+
+class DistinctCounter {
+public:
+    // copy and move constructor and assignment not implemented
+    DistinctCounter(const DistinctCounter&)=delete;
+    DistinctCounter& operator=(const DistinctCounter&)=delete;
+    DistinctCounter(const DistinctCounter&&)=delete;
+    DistinctCounter& operator=(const DistinctCounter&&)=delete;
+
+    /// @brief Constructs a bit array with one bit for every value below 2^31, recording which
+    /// values have been seen. The array is one flat allocation so marking a value is a single
+    /// indexed store, like a std::bitset. The allocation is large enough that the OS maps its
+    /// zeroed pages lazily, so untouched regions cost no memory, and a flag per 128 KiB chunk
+    /// lets counting skip them.
+    DistinctCounter() :
+        words{static_cast<uint64_t*>(std::calloc(ChunkCount * WordsPerChunk, sizeof(uint64_t)))},
+        touched(ChunkCount, 0),
+        popcount{select_popcount()}
+    {
+        if (!words)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    ~DistinctCounter()
+    {
+        std::free(words);
+    }
+
+    /// @brief Marks a value as seen
+    /// @param value A value below 2^31
+    void set(uint32_t value)
+    {
+        // an unconditional store instead of a check keeps the dense case as cheap as a bitset
+        touched[value >> ChunkShift] = 1;
+        words[value / 64] |= uint64_t{1} << (value % 64);
+    }
+
+    /// @brief Marks a value as seen. Safe to call from several threads at once: the bit is set
+    /// with an atomic OR.
+    /// @param value A value below 2^31
+    void set_concurrent(uint32_t value)
+    {
+        uint32_t* flag = &touched[value >> ChunkShift];
+        if (!__atomic_load_n(flag, __ATOMIC_RELAXED))
+        {
+            __atomic_store_n(flag, 1, __ATOMIC_RELAXED);
+        }
+
+        uint64_t mask = uint64_t{1} << (value % 64);
+        uint64_t* word = &words[value / 64];
+        // most values hit bits that are already set once the array fills, so avoid the locked
+        // instruction and the cache line bouncing between cores that it causes
+        if (!(__atomic_load_n(word, __ATOMIC_RELAXED) & mask))
+        {
+            __atomic_fetch_or(word, mask, __ATOMIC_RELAXED);
+        }
+    }
+
+    /// @brief Returns the number of distinct values seen. The touched chunks are split between
+    /// threads and each is counted with the fastest popcount the CPU supports.
+    /// @param threadCount The number of threads to count with, or 0 for one per hardware thread
+    /// @return
+    long long count(int threadCount = 0) const
+    {
+        if (threadCount < 1)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        std::vector<long long> counts(threadCount);
+        std::vector<std::thread> workers;
+        int chunksPerThread = (ChunkCount + threadCount - 1) / threadCount;
+
+        for (int thread = 0; thread < threadCount; thread++)
+        {
+            workers.emplace_back([&, thread]() {
+                int first = thread * chunksPerThread;
+                int last = std::min(ChunkCount, first + chunksPerThread);
+                long long result = 0;
+                for (int i = first; i < last; i++)
+                {
+                    if (touched[i])
+                    {
+                        result += popcount(words + (i * WordsPerChunk), WordsPerChunk);
+                    }
+                }
+                counts[thread] = result;
+            });
+        }
+
+        long long result = 0;
+        for (int thread = 0; thread < threadCount; thread++)
+        {
+            workers[thread].join();
+            result += counts[thread];
+        }
+
+        return result;
+    }
+
+    /// @brief Returns the number of bytes of the bit array backed by memory, i.e. the touched
+    /// chunks
+    /// @return
+    size_t memory_usage() const
+    {
+        size_t result = touched.capacity() * sizeof(touched[0]);
+        for (uint32_t flag : touched)
+        {
+            result += flag ? WordsPerChunk * sizeof(uint64_t) : 0;
+        }
+        return result;
+    }
+
+private:
+    static constexpr int ChunkShift = 20;
+    static constexpr uint32_t ChunkBits = uint32_t{1} << ChunkShift;
+    static constexpr size_t WordsPerChunk = ChunkBits / 64;
+    static constexpr int ChunkCount = static_cast<int>(MOD >> ChunkShift);
+
+    // owned. the flags are words rather than bytes, since a byte store may alias any object and
+    // would make the compiler reload words after every mark
+    uint64_t* words;
+    std::vector<uint32_t> touched;
+    long long (*popcount)(const uint64_t*, size_t);
+};
+
+class RoaringBitmap {
+public:
+    // copy and move constructor and assignment not implemented
+    RoaringBitmap(const RoaringBitmap&)=delete;
+    RoaringBitmap& operator=(const RoaringBitmap&)=delete;
+    RoaringBitmap(const RoaringBitmap&&)=delete;
+    RoaringBitmap& operator=(const RoaringBitmap&&)=delete;
+
+    /// @brief Constructs a compressed bitmap of 32 bit values. Values are grouped by their high
+    /// 16 bits into containers of 65536 values, each stored as whichever is smallest of a sorted
+    /// array of values, an 8 KiB bitmap or a list of runs, so memory follows the values set rather
+    /// than the range they span.
+    RoaringBitmap() :
+        lastSlot{NoSlot},
+        popcount{select_popcount()}
+    { }
+
+    /// @brief Marks a value as seen
+    /// @param value
+    void set(uint32_t value)
+    {
+        Container& container = get_or_add_container(value >> 16);
+        uint16_t low = value & 0xffff;
+
+        switch (container.type)
+        {
+            case ContainerType::Array:
+                set_in_array(container, low);
+                break;
+            case ContainerType::Bitmap:
+                set_in_bitmap(container, low);
+                break;
+            case ContainerType::Run:
+                set_in_runs(container, low);
+                break;
+        }
+    }
+
+    /// @brief Returns if a value has been set
+    /// @param value
+    /// @return
+    bool contains(uint32_t value) const
+    {
+        int slot = find_slot(value >> 16);
+        return slot != NoSlot && container_contains(containers[slot], value & 0xffff);
+    }
+
+    /// @brief Returns the number of values set. Each container tracks its own cardinality, so
+    /// this only visits the containers.
+    /// @return
+    long long count() const
+    {
+        long long result = 0;
+        for (const auto& container : containers)
+        {
+            result += container.cardinality;
+        }
+        return result;
+    }
+
+    /// @brief Sets every value that is set in another bitmap
+    /// @param other
+    void union_with(const RoaringBitmap& other)
+    {
+        std::vector<uint32_t> unitedIndex;
+        std::vector<Container> united;
+        size_t i = 0;
+        size_t j = 0;
+
+        while (i < index.size() || j < other.index.size())
+        {
+            int key = i < index.size() ? entry_key(index[i]) : INT32_MAX;
+            int otherKey = j < other.index.size() ? entry_key(other.index[j]) : INT32_MAX;
+
+            if (key < otherKey)
+            {
+                united.push_back(std::move(containers[entry_slot(index[i++])]));
+            }
+            else if (otherKey < key)
+            {
+                united.push_back(other.containers[entry_slot(other.index[j++])]);
+            }
+            else
+            {
+                Container& container = containers[entry_slot(index[i++])];
+                unite_containers(container, other.containers[entry_slot(other.index[j++])]);
+                united.push_back(std::move(container));
+            }
+            unitedIndex.push_back(make_entry(united.back().key, united.size() - 1));
+        }
+
+        index = std::move(unitedIndex);
+        containers = std::move(united);
+        lastSlot = NoSlot;
+        rebuild_lookup();
+    }
+
+    /// @brief Clears every value that is not set in another bitmap
+    /// @param other
+    void intersect_with(const RoaringBitmap& other)
+    {
+        std::vector<uint32_t> intersectedIndex;
+        std::vector<Container> intersected;
+        size_t j = 0;
+
+        for (uint32_t entry : index)
+        {
+            int key = entry_key(entry);
+            while (j < other.index.size() && entry_key(other.index[j]) < key)
+            {
+                j++;
+            }
+            if (j == other.index.size() || entry_key(other.index[j]) != key)
+            {
+                continue;
+            }
+
+            Container& container = containers[entry_slot(entry)];
+            intersect_containers(container, other.containers[entry_slot(other.index[j])]);
+            if (container.cardinality > 0)
+            {
+                intersected.push_back(std::move(container));
+                intersectedIndex.push_back(make_entry(key, intersected.size() - 1));
+            }
+        }
+
+        index = std::move(intersectedIndex);
+        containers = std::move(intersected);
+        lastSlot = NoSlot;
+        rebuild_lookup();
+    }
+
+    /// @brief Converts every container to its smallest representation. Containers only change
+    /// type when an array fills up or a run list grows too long, so a bitmap that was filled and
+    /// later became a few long runs is only compacted by this.
+    void optimize()
+    {
+        for (auto& container : containers)
+        {
+            recompress(container);
+        }
+    }
+
+    /// @brief Returns the number of bytes allocated for the bitmap
+    /// @return
+    size_t memory_usage() const
+    {
+        size_t result = index.capacity() * sizeof(uint32_t) + containers.capacity() * sizeof(Container)
+            + slotByKey.capacity() * sizeof(int);
+        for (const auto& container : containers)
+        {
+            result += container.values.capacity() * sizeof(uint16_t) + container.words.capacity() * sizeof(uint64_t);
+        }
+        return result;
+    }
+
+private:
+    enum class ContainerType : uint8_t {Array, Bitmap, Run};
+
+    struct Container
+    {
+        uint16_t key;
+        ContainerType type;
+        int cardinality;
+        // the sorted values of an array container, or the sorted (start, length - 1) pairs of
+        // a run container
+        std::vector<uint16_t> values;
+        // the bits of a bitmap container
+        std::vector<uint64_t> words;
+    };
+
+    static constexpr int NoSlot = -1;
+    static constexpr int MaxArraySize = 4096;
+    static constexpr int BitmapWords = 65536 / 64;
+    // a run container takes 4 bytes per run, so past this it is larger than a bitmap
+    static constexpr int MaxRuns = BitmapWords * 8 / 4;
+    static constexpr size_t DirectLookupContainers = 1024;
+
+    // one entry per container, sorted by key: the key in the high 16 bits and the container's
+    // slot in the low 16 bits. New containers are appended, so only these entries are shifted.
+    std::vector<uint32_t> index;
+    std::vector<Container> containers;
+    // the slot of every key, only allocated once there are enough containers that searching the
+    // index on every set costs more than its 256 KiB
+    std::vector<int> slotByKey;
+    int lastSlot;
+    long long (*popcount)(const uint64_t*, size_t);
+
+    static uint32_t make_entry(int key, size_t slot)
+    {
+        return (static_cast<uint32_t>(key) << 16) | static_cast<uint32_t>(slot);
+    }
+
+    static int entry_key(uint32_t entry)
+    {
+        return entry >> 16;
+    }
+
+    static int entry_slot(uint32_t entry)
+    {
+        return entry & 0xffff;
+    }
+
+    int find_slot(int key) const
+    {
+        if (!slotByKey.empty())
+        {
+            return slotByKey[key];
+        }
+
+        auto it = std::lower_bound(index.begin(), index.end(), make_entry(key, 0));
+        return it != index.end() && entry_key(*it) == key ? entry_slot(*it) : NoSlot;
+    }
+
+    Container& get_or_add_container(int key)
+    {
+        // consecutive values usually share a container
+        if (lastSlot != NoSlot && containers[lastSlot].key == key)
+        {
+            return containers[lastSlot];
+        }
+
+        lastSlot = find_slot(key);
+        if (lastSlot == NoSlot)
+        {
+            lastSlot = containers.size();
+            containers.push_back(Container{static_cast<uint16_t>(key), ContainerType::Array, 0, {}, {}});
+            index.insert(std::lower_bound(index.begin(), index.end(), make_entry(key, 0)), make_entry(key, lastSlot));
+
+            if (!slotByKey.empty())
+            {
+                slotByKey[key] = lastSlot;
+            }
+            else if (containers.size() >= DirectLookupContainers)
+            {
+                rebuild_lookup();
+            }
+        }
+        return containers[lastSlot];
+    }
+
+    /// @brief Rebuilds the slot of every key after containers were added or removed
+    void rebuild_lookup()
+    {
+        if (containers.size() < DirectLookupContainers)
+        {
+            slotByKey.clear();
+            slotByKey.shrink_to_fit();
+            return;
+        }
+
+        slotByKey.assign(65536, NoSlot);
+        for (uint32_t entry : index)
+        {
+            slotByKey[entry_key(entry)] = entry_slot(entry);
+        }
+    }
+
+    static bool container_contains(const Container& container, uint16_t low)
+    {
+        switch (container.type)
+        {
+            case ContainerType::Array:
+                return std::binary_search(container.values.begin(), container.values.end(), low);
+            case ContainerType::Bitmap:
+                return (container.words[low / 64] >> (low % 64)) & 1;
+            case ContainerType::Run:
+            {
+                int run = find_run(container, low);
+                return run > 0 && low <= run_end(container, run - 1);
+            }
+        }
+        return false;
+    }
+
+    static void set_in_array(Container& container, uint16_t low)
+    {
+        auto it = std::lower_bound(container.values.begin(), container.values.end(), low);
+        if (it != container.values.end() && *it == low)
+        {
+            return;
+        }
+
+        container.values.insert(it, low);
+        container.cardinality++;
+        if (container.cardinality > MaxArraySize)
+        {
+            recompress(container);
+        }
+    }
+
+    static void set_in_bitmap(Container& container, uint16_t low)
+    {
+        uint64_t bit = uint64_t{1} << (low % 64);
+        if (!(container.words[low / 64] & bit))
+        {
+            container.words[low / 64] |= bit;
+            container.cardinality++;
+        }
+    }
+
+    static void set_in_runs(Container& container, uint16_t low)
+    {
+        auto& runs = container.values;
+        int run = find_run(container, low);
+        int runCount = runs.size() / 2;
+
+        if (run > 0 && low <= run_end(container, run - 1))
+        {
+            return;
+        }
+
+        bool extendsPrevious = run > 0 && run_end(container, run - 1) + 1 == low;
+        bool extendsNext = run < runCount && runs[2 * run] == low + 1;
+        if (extendsPrevious && extendsNext)
+        {
+            runs[2 * (run - 1) + 1] += runs[2 * run + 1] + 2;
+            runs.erase(runs.begin() + 2 * run, runs.begin() + 2 * run + 2);
+        }
+        else if (extendsPrevious)
+        {
+            runs[2 * (run - 1) + 1]++;
+        }
+        else if (extendsNext)
+        {
+            runs[2 * run] = low;
+            runs[2 * run + 1]++;
+        }
+        else
+        {
+            uint16_t newRun[] = {low, 0};
+            runs.insert(runs.begin() + 2 * run, std::begin(newRun), std::end(newRun));
+        }
+        container.cardinality++;
+
+        if (static_cast<int>(runs.size() / 2) > MaxRuns)
+        {
+            recompress(container);
+        }
+    }
+
+    /// @brief Converts a container to its smallest representation. Not inlined, so the 8 KiB
+    /// buffer is only on the stack when a container changes type, not on every set.
+    __attribute__((noinline))
+    static void recompress(Container& container)
+    {
+        std::array<uint64_t, BitmapWords> words;
+        to_bitmap(container, words.data());
+        from_bitmap(container, words.data(), container.cardinality);
+    }
+
+    /// @brief Returns the index of the first run starting after a value
+    static int find_run(const Container& container, uint16_t low)
+    {
+        int first = 0;
+        int last = container.values.size() / 2;
+        while (first < last)
+        {
+            int middle = (first + last) / 2;
+            if (container.values[2 * middle] <= low)
+            {
+                first = middle + 1;
+            }
+            else
+            {
+                last = middle;
+            }
+        }
+        return first;
+    }
+
+    static int run_end(const Container& container, int run)
+    {
+        return container.values[2 * run] + container.values[2 * run + 1];
+    }
+
+    static void to_bitmap(const Container& container, uint64_t* words)
+    {
+        switch (container.type)
+        {
+            case ContainerType::Array:
+                std::fill(words, words + BitmapWords, 0);
+                for (uint16_t low : container.values)
+                {
+                    words[low / 64] |= uint64_t{1} << (low % 64);
+                }
+                break;
+            case ContainerType::Bitmap:
+                std::copy(container.words.begin(), container.words.end(), words);
+                break;
+            case ContainerType::Run:
+                std::fill(words, words + BitmapWords, 0);
+                for (size_t run = 0; run < container.values.size() / 2; run++)
+                {
+                    set_range(words, container.values[2 * run], run_end(container, run) + 1);
+                }
+                break;
+        }
+    }
+
+    /// @brief Sets the bits from first up to but not including last
+    static void set_range(uint64_t* words, int first, int last)
+    {
+        int firstWord = first / 64;
+        int lastWord = (last - 1) / 64;
+        uint64_t firstMask = ~uint64_t{0} << (first % 64);
+        uint64_t lastMask = ~uint64_t{0} >> (63 - (last - 1) % 64);
+
+        if (firstWord == lastWord)
+        {
+            words[firstWord] |= firstMask & lastMask;
+            return;
+        }
+
+        words[firstWord] |= firstMask;
+        std::fill(words + firstWord + 1, words + lastWord, ~uint64_t{0});
+        words[lastWord] |= lastMask;
+    }
+
+    /// @brief Stores a bitmap in a container as whichever of an array, bitmap or runs is smallest
+    static void from_bitmap(Container& container, const uint64_t* words, int cardinality)
+    {
+        // a run starts at each set bit whose lower neighbour is clear
+        int runCount = 0;
+        uint64_t carry = 0;
+        for (int i = 0; i < BitmapWords; i++)
+        {
+            runCount += __builtin_popcountll(words[i] & ~((words[i] << 1) | carry));
+            carry = words[i] >> 63;
+        }
+
+        container.cardinality = cardinality;
+        container.values.clear();
+        container.words.clear();
+
+        if (runCount * 4 < std::min(cardinality * 2, BitmapWords * 8))
+        {
+            container.type = ContainerType::Run;
+            container.values.reserve(runCount * 2);
+            int low = 0;
+            while ((low = next_bit(words, low, true)) < 65536)
+            {
+                int end = next_bit(words, low, false);
+                container.values.push_back(low);
+                container.values.push_back(end - low - 1);
+                low = end;
+            }
+        }
+        else if (cardinality <= MaxArraySize)
+        {
+            container.type = ContainerType::Array;
+            container.values.reserve(cardinality);
+            for (int i = 0; i < BitmapWords; i++)
+            {
+                for (uint64_t word = words[i]; word != 0; word &= word - 1)
+                {
+                    container.values.push_back(i * 64 + __builtin_ctzll(word));
+                }
+            }
+        }
+        else
+        {
+            container.type = ContainerType::Bitmap;
+            container.words.assign(words, words + BitmapWords);
+        }
+        container.values.shrink_to_fit();
+        container.words.shrink_to_fit();
+    }
+
+    /// @brief Returns the position of the first bit at or after a position that is set or clear
+    static int next_bit(const uint64_t* words, int position, bool isSet)
+    {
+        for (int i = position / 64; i < BitmapWords; i++)
+        {
+            uint64_t word = isSet ? words[i] : ~words[i];
+            if (i == position / 64)
+            {
+                word &= ~uint64_t{0} << (position % 64);
+            }
+            if (word != 0)
+            {
+                return i * 64 + __builtin_ctzll(word);
+            }
+        }
+        return 65536;
+    }
+
+    void unite_containers(Container& container, const Container& other)
+    {
+        if (container.type == ContainerType::Array && other.type == ContainerType::Array
+            && container.cardinality + other.cardinality <= MaxArraySize)
+        {
+            std::vector<uint16_t> united;
+            united.reserve(container.cardinality + other.cardinality);
+            std::set_union(container.values.begin(), container.values.end(),
+                other.values.begin(), other.values.end(), std::back_inserter(united));
+            container.values = std::move(united);
+            container.cardinality = container.values.size();
+            return;
+        }
+
+        std::array<uint64_t, BitmapWords> words;
+        std::array<uint64_t, BitmapWords> otherWords;
+        to_bitmap(container, words.data());
+        to_bitmap(other, otherWords.data());
+        for (int i = 0; i < BitmapWords; i++)
+        {
+            words[i] |= otherWords[i];
+        }
+        from_bitmap(container, words.data(), popcount(words.data(), BitmapWords));
+    }
+
+    void intersect_containers(Container& container, const Container& other)
+    {
+        // an array stays an array, so only its values need checking against the other container
+        if (container.type == ContainerType::Array || other.type == ContainerType::Array)
+        {
+            const Container& array = container.type == ContainerType::Array ? container : other;
+            const Container& filter = container.type == ContainerType::Array ? other : container;
+            std::vector<uint16_t> intersected;
+            if (filter.type == ContainerType::Array)
+            {
+                std::set_intersection(array.values.begin(), array.values.end(),
+                    filter.values.begin(), filter.values.end(), std::back_inserter(intersected));
+            }
+            else
+            {
+                for (uint16_t low : array.values)
+                {
+                    if (container_contains(filter, low))
+                    {
+                        intersected.push_back(low);
+                    }
+                }
+            }
+            container.type = ContainerType::Array;
+            container.values = std::move(intersected);
+            container.words.clear();
+            container.words.shrink_to_fit();
+            container.cardinality = container.values.size();
+            return;
+        }
+
+        std::array<uint64_t, BitmapWords> words;
+        std::array<uint64_t, BitmapWords> otherWords;
+        to_bitmap(container, words.data());
+        to_bitmap(other, otherWords.data());
+        for (int i = 0; i < BitmapWords; i++)
+        {
+            words[i] &= otherWords[i];
+        }
+        from_bitmap(container, words.data(), popcount(words.data(), BitmapWords));
+    }
+};
+
+class PhaseTimer {
+public:
+    /// @brief Times the phases of the program. When built with -DBENCHMARK, the time each phase
+    /// took is written to stderr, so stdout still only holds the answer.
+    PhaseTimer() :
+        phaseStart{std::chrono::steady_clock::now()}
+    { }
+
+    /// @brief Ends the current phase and starts the next one
+    /// @param name The name of the phase that ended
+    void end_phase([[maybe_unused]] const char* name)
+    {
+#ifdef BENCHMARK
+        auto now = std::chrono::steady_clock::now();
+        std::fprintf(stderr, "%s: %.3f ms\n", name, std::chrono::duration<double, std::milli>(now - phaseStart).count());
+        phaseStart = now;
+#endif
+    }
+
+private:
+    std::chrono::steady_clock::time_point phaseStart;
+};
+
+/// @brief Returns the next value of the sequence a[i] = (a[i-1] * p + q) mod 2^31
+static inline long long next_value(long long value, long long p, long long q)
+{
+    return (value * p + q) % MOD;
+}
+
+/// @brief The map x -> (multiplier * x + increment) mod 2^31, one or more steps of the sequence
+struct AffineMap
+{
+    long long multiplier;
+    long long increment;
+};
+
+/// @brief Returns the map that applies first and then second
+static AffineMap compose(AffineMap first, AffineMap second)
+{
+    return AffineMap{
+        (second.multiplier * first.multiplier) % MOD,
+        (second.multiplier * first.increment + second.increment) % MOD};
+}
+
+/// @brief Returns the map that advances the sequence k terms, by squaring the single step map
+/// in O(log k) compositions
+/// @param p
+/// @param q
+/// @param k The number of terms to advance
+/// @return
+static AffineMap jump_ahead(long long p, long long q, long long k)
+{
+    AffineMap result{1, 0};
+    AffineMap step{p % MOD, q % MOD};
+    for (; k > 0; k /= 2)
+    {
+        if (k % 2)
+        {
+            result = compose(result, step);
+        }
+        step = compose(step, step);
+    }
+    return result;
+}
+
+static constexpr long long NoCycle = -1;
+
+// about a millisecond of stepping, next to seconds of marking when the cycle is long
+static constexpr long long CycleSearchBudget = 1 << 20;
+
+/// @brief Counts the distinct values among the first n terms of the sequence by finding its
+/// cycle with Brent's algorithm, in constant memory. The sequence is eventually periodic, so the
+/// first n terms hold min(n, mu + lambda) distinct values, where mu is the length of the tail
+/// before the cycle and lambda the length of the cycle.
+/// @param n The number of terms
+/// @param s The first term
+/// @param p
+/// @param q
+/// @param budget The number of steps to search for the cycle before giving up
+/// @return The number of distinct values, or NoCycle if no cycle was found within budget steps
+static long long count_distinct_by_cycle(long long n, long long s, long long p, long long q, long long budget)
+{
+    // find the cycle length: the tortoise waits at each power of two while the hare runs ahead
+    long long tortoise = s;
+    long long hare = next_value(s, p, q);
+    long long power = 1;
+    long long lambda = 1;
+    for (long long steps = 1; tortoise != hare; steps++)
+    {
+        if (steps > budget)
+        {
+            return NoCycle;
+        }
+        if (power == lambda)
+        {
+            tortoise = hare;
+            power *= 2;
+            lambda = 0;
+        }
+        hare = next_value(hare, p, q);
+        lambda++;
+    }
+
+    // find the tail length: with the hare lambda terms ahead, the two first meet at the start
+    // of the cycle. Once the tail covers n terms the answer is n, so stop there.
+    tortoise = hare = s;
+    for (long long i = 0; i < lambda; i++)
+    {
+        hare = next_value(hare, p, q);
+    }
+    long long mu = 0;
+    while (tortoise != hare && mu < n)
+    {
+        tortoise = next_value(tortoise, p, q);
+        hare = next_value(hare, p, q);
+        mu++;
+    }
+
+    return std::min(n, mu + lambda);
+}
+
+/// @brief Counts the distinct values among the first n terms of the sequence by marking each
+/// term in a bit array
+/// @tparam TBitArray DistinctCounter or RoaringBitmap
+/// @param numbersSeen An empty bit array
+/// @param n The number of terms
+/// @param s The first term
+/// @param p
+/// @param q
+/// @param timer
+/// @return
+template <typename TBitArray>
+static long long count_distinct_by_marking(TBitArray& numbersSeen, long long n, long long s, long long p, long long q, PhaseTimer& timer)
+{
+    // populate the first value
+    long long prevVal = s;
+    numbersSeen.set(s);
+
+    // now calculate the remaining values
+    for (long long i = 1; i < n; i++)
+    {
+        auto val = next_value(prevVal, p, q);
+        numbersSeen.set(val);
+        prevVal = val;
+    }
+    timer.end_phase("generate");
+
+    long long result = numbersSeen.count();
+    timer.end_phase("count");
+
+    return result;
+}
+
+/// @brief Counts the distinct values among the first n terms of the sequence by splitting the
+/// terms between threads. Each thread jumps ahead to the first term of its range and marks its
+/// terms directly in the shared bit array.
+/// @param numbersSeen An empty bit array
+/// @param n The number of terms
+/// @param s The first term
+/// @param p
+/// @param q
+/// @param threadCount The number of threads to mark with, or 0 for one per hardware thread
+/// @param timer
+/// @return
+[[maybe_unused]] static long long count_distinct_in_parallel(DistinctCounter& numbersSeen, long long n, long long s, long long p, long long q, int threadCount, PhaseTimer& timer)
+{
+    // below this, starting a thread costs more than marking its terms
+    constexpr long long MinTermsPerThread = 1 << 16;
+
+    if (threadCount < 1)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = static_cast<int>(std::max(1LL, std::min<long long>(threadCount, n / MinTermsPerThread)));
+    if (threadCount == 1)
+    {
+        // plain stores are cheaper than atomic ones when nothing runs concurrently
+        return count_distinct_by_marking(numbersSeen, n, s, p, q, timer);
+    }
+
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < threadCount; thread++)
+    {
+        long long first = n * thread / threadCount;
+        long long last = n * (thread + 1) / threadCount;
+        AffineMap toFirst = jump_ahead(p, q, first);
+
+        workers.emplace_back([&numbersSeen, first, last, p, q, toFirst, s]() {
+            long long val = (toFirst.multiplier * s + toFirst.increment) % MOD;
+            numbersSeen.set_concurrent(val);
+            for (long long i = first + 1; i < last; i++)
+            {
+                val = next_value(val, p, q);
+                numbersSeen.set_concurrent(val);
+            }
+        });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    timer.end_phase("generate");
+
+    long long result = numbersSeen.count();
+    timer.end_phase("count");
+
+    return result;
+}
+
+// the dense bit array is fastest when most of the 2^31 values are reached. Build with
+// -DROARING_BITMAP to use the compressed bitmap, which only takes memory for the values set.
+#ifdef ROARING_BITMAP
+using BitArray = RoaringBitmap;
+#else
+using BitArray = DistinctCounter;
+#endif
+
+#ifdef BENCHMARK
+
+/// @brief Fills both bit arrays with the sequence, the dense one also in parallel, reporting the time and memory each takes,
+/// then times union and intersection of compressed bitmaps of this and a shifted sequence
+static void compare_bit_arrays(long long n, long long s, long long p, long long q)
+{
+    PhaseTimer timer;
+
+    std::fprintf(stderr, "dense bit array\n");
+    {
+        DistinctCounter numbersSeen;
+        count_distinct_by_marking(numbersSeen, n, s, p, q, timer);
+        std::fprintf(stderr, "memory: %.3f MiB\n", numbersSeen.memory_usage() / 1048576.0);
+    }
+
+    int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::fprintf(stderr, "dense bit array, %d threads\n", threadCount);
+    {
+        DistinctCounter numbersSeen;
+        count_distinct_in_parallel(numbersSeen, n, s, p, q, threadCount, timer);
+    }
+
+    std::fprintf(stderr, "roaring bitmap\n");
+    RoaringBitmap numbersSeen;
+    count_distinct_by_marking(numbersSeen, n, s, p, q, timer);
+    std::fprintf(stderr, "memory: %.3f MiB\n", numbersSeen.memory_usage() / 1048576.0);
+    numbersSeen.optimize();
+    timer.end_phase("optimize");
+    std::fprintf(stderr, "memory: %.3f MiB\n", numbersSeen.memory_usage() / 1048576.0);
+
+    long long count = numbersSeen.count();
+
+    std::fprintf(stderr, "shifted roaring bitmaps\n");
+    RoaringBitmap shiftedSeen;
+    RoaringBitmap intersection;
+    long long shiftedCount = count_distinct_by_marking(shiftedSeen, n, next_value(s, p, q) ^ 1, p, q, timer);
+    count_distinct_by_marking(intersection, n, s, p, q, timer);
+
+    numbersSeen.union_with(shiftedSeen);
+    timer.end_phase("union");
+    intersection.intersect_with(shiftedSeen);
+    timer.end_phase("intersection");
+
+    // |A u B| = |A| + |B| - |A n B|
+    std::fprintf(stderr, "%lld + %lld - %lld = %lld\n", count, shiftedCount, intersection.count(), numbersSeen.count());
+}
+
+#endif
 
 int main() {
     long long n, s, p, q;
@@ -21,20 +1070,29 @@ int main() {
     cin >> p;
     cin >> q;
 
-    // populate the first value
-    long long prevVal = s;
-    numbersSeen[s] = true;
+    PhaseTimer timer;
 
-    // now calculate the remaining values
-    for (long long i = 1; i < n; i++)
+    // the sequence must cycle, so first look for a short cycle without touching memory. A miss
+    // throws the search away, so it gets a small fixed budget rather than n steps, and no more
+    // steps than a small input has terms.
+    long long result = count_distinct_by_cycle(n, s, p, q, std::min<long long>(CycleSearchBudget, n + 1));
+    timer.end_phase("cycle");
+
+    if (result == NoCycle)
     {
-        auto rawVal = (prevVal * p) + q;
-        auto val = rawVal % MOD;
-        numbersSeen[val] = true;
-        prevVal = val;
+        BitArray numbersSeen;
+#ifdef ROARING_BITMAP
+        result = count_distinct_by_marking(numbersSeen, n, s, p, q, timer);
+#else
+        result = count_distinct_in_parallel(numbersSeen, n, s, p, q, 0, timer);
+#endif
     }
-    
-    cout << numbersSeen.count();
+
+#ifdef BENCHMARK
+    compare_bit_arrays(n, s, p, q);
+#endif
+
+    cout << result;
 
     return 0;
 }
@@ -1,403 +1,495 @@
 // Solves: https://www.hackerrank.com/challenges/deque-stl/problem?isFullScreen=true
 
+#include <algorithm>
+#include <charconv>
+#include <functional>
 #include <iostream>
-#include <deque> 
-#include <cmath>
 #include <stdexcept>
+#include <type_traits>
 #include <vector>
 using namespace std;
 
+template<typename TValue, typename TCompare>
+class MonotonicWindow {
+public:
+    /// @brief Constructs a sliding window that tracks its extreme value (the max when TCompare is
+    /// std::greater, the min when TCompare is std::less) in amortized constant time. Only the
+    /// samples that can still become the extreme are kept, in a ring buffer of the window size,
+    /// ordered so the extreme is always at the front.
+    /// @param windowSize The number of most recent samples in the window
+    MonotonicWindow(int windowSize) :
+        windowSize{windowSize},
+        values{},
+        positions{},
+        front{0},
+        count{0},
+        nextPosition{0},
+        compare{}
+    {
+        if (windowSize < 1)
+        {
+            throw std::out_of_range("Window size must be greater than 0");
+        }
 
-// Binary Heap code copied from MovingMedian.cpp (code is not properly arranged into header files)
+        values.resize(windowSize);
+        positions.resize(windowSize);
+    }
 
+    /// @brief Returns the number of samples currently in the window
+    /// @return 
+    int getCount() const
+    {
+        return static_cast<int>(std::min<long long>(nextPosition, windowSize));
+    }
 
-template<typename TValue>
-class BinaryHeapNode;
+    /// @brief Returns the extreme value of the samples in the window. The window must not be empty.
+    /// @return 
+    TValue getExtreme() const
+    {
+        return values[front];
+    }
 
-template<typename TValue>
-class BinaryHeap;
+    /// @brief Adds a sample to the window, dropping the oldest sample if the window is full
+    /// @param value 
+    void add(TValue value)
+    {
+        // the front candidate leaves the window when the new sample pushes it out
+        if ((count > 0) && (positions[front] <= (nextPosition - windowSize)))
+        {
+            front = wrap(front + 1);
+            count--;
+        }
 
-template<typename TValue>
-class BinaryHeapNode {
-public:
-    int index;
-    TValue value;
-    BinaryHeap<TValue>* heap;
+        // candidates at the back that don't beat the new sample can never be the extreme again
+        while ((count > 0) && !compare(values[wrap(front + count - 1)], value))
+        {
+            count--;
+        }
 
-    // copy and move constructor and assignment not implemented
-    BinaryHeapNode(const BinaryHeapNode&)=delete;
-    BinaryHeapNode& operator=(const BinaryHeapNode&)=delete;
-    BinaryHeapNode(const BinaryHeapNode&&)=delete;
-    BinaryHeapNode& operator=(const BinaryHeapNode&&)=delete;
-
-    /// @brief Constructs new binary heap node
-    /// @param index The index of this node in the underlying heap vector
-    /// @param value The value of the node
-    /// @param heap A pointer to the heap this node belongs to
-    BinaryHeapNode(int index, TValue value, BinaryHeap<TValue>* heap) :
-        index{index},
-        value{value},
-        heap{heap}
-    {}
+        int back = wrap(front + count);
+        values[back] = value;
+        positions[back] = nextPosition;
+        count++;
+        nextPosition++;
+    }
+
+private:
+    int windowSize;
+    std::vector<TValue> values;
+    std::vector<long long> positions;
+    int front;
+    int count;
+    long long nextPosition;
+    TCompare compare;
+
+    /// @brief Wraps an index that is at most one lap past the end of the ring
+    /// @param index 
+    /// @return 
+    int wrap(int index) const
+    {
+        return (index >= windowSize) ? (index - windowSize) : index;
+    }
 };
 
 template<typename TValue>
-class BinaryHeap {
+class SlidingWindowExtremes {
 public:
-    // copy and move constructor and assignment not implemented
-    BinaryHeap(const BinaryHeap&)=delete;
-    BinaryHeap& operator=(const BinaryHeap&)=delete;
-    BinaryHeap(const BinaryHeap&&)=delete;
-    BinaryHeap& operator=(const BinaryHeap&&)=delete;
-
-    /// @brief Constructs a binary heap. This class offers similar functionality to the STL heap
-    /// algothims but allows arbitrary nodes to be updated while maintaining the heap property.
-    /// When arbitrary nodes are updated, the heap is fixed up in logarithmic time.
-    /// @param isMaxHeap True if max heap, false if min heap
-    /// @param capacity The maximum number of elements to store in the heap
-    BinaryHeap(bool isMaxHeap, int capacity) :
-        isMaxHeap{isMaxHeap},
-        heap{}
+    /// @brief Constructs a sliding window that tracks both its min and max values in amortized
+    /// constant time
+    /// @param windowSize The number of most recent samples in the window
+    SlidingWindowExtremes(int windowSize) :
+        minWindow(windowSize),
+        maxWindow(windowSize)
+    { }
+
+    /// @brief Returns the number of samples currently in the window
+    /// @return 
+    int getCount() const
     {
-        if (capacity < 1)
-        {
-            throw std::out_of_range("Capacity must be greater than 0");
-        }
-
-        heap.reserve(capacity);
+        return maxWindow.getCount();
     }
 
-    /// @brief Returns the number of nodes currently in the heap
+    /// @brief Returns the min value in the window. The window must not be empty.
     /// @return 
-    int size() const
+    TValue getMin() const
     {
-        return heap.size();
+        return minWindow.getExtreme();
     }
 
-    /// @brief Returns the maximum number of nodes that can be in the heap
+    /// @brief Returns the max value in the window. The window must not be empty.
     /// @return 
-    int capacity() const
+    TValue getMax() const
     {
-        return heap.capacity();
+        return maxWindow.getExtreme();
     }
 
-    /// @brief adds a new element to the heap
-    /// @param value The value of the new element to add
-    /// @return A reference to the newly added heap node
-    BinaryHeapNode<TValue>& add(TValue value)
+    /// @brief Adds a sample to the window, dropping the oldest sample if the window is full
+    /// @param value 
+    void add(TValue value)
     {
-        int count = size();
-        if (count == capacity())
+        minWindow.add(value);
+        maxWindow.add(value);
+    }
+
+private:
+    MonotonicWindow<TValue, std::less<TValue>> minWindow;
+    MonotonicWindow<TValue, std::greater<TValue>> maxWindow;
+};
+
+/// @brief Calls the callback with the extreme value of every window of windowSize contiguous
+/// values, in order
+/// @param values The input values
+/// @param count The number of input values
+/// @param windowSize The number of values in each window, at most count
+/// @param callback Called count - windowSize + 1 times with each window's extreme value
+template<typename TValue, typename TCompare, typename TCallback>
+void forEachWindowExtreme(const TValue* values, int count, int windowSize, TCallback&& callback)
+{
+    MonotonicWindow<TValue, TCompare> window(windowSize);
+
+    for (int i = 0; i < count; i++)
+    {
+        window.add(values[i]);
+        if (i >= (windowSize - 1))
         {
-            throw std::runtime_error("Heap is full!");
+            callback(window.getExtreme());
         }
+    }
+}
 
-        // allocate a new node on the heap and add reference to the end of the heap vector
-        BinaryHeapNode<TValue>* node = new BinaryHeapNode<TValue>(count, value, this);
-        heap.push_back(node);
+/// @brief Calls the callback with the max value of every window of windowSize contiguous values
+template<typename TValue, typename TCallback>
+void forEachWindowMax(const TValue* values, int count, int windowSize, TCallback&& callback)
+{
+    forEachWindowExtreme<TValue, std::greater<TValue>>(values, count, windowSize, callback);
+}
 
-        // now fix up the heap to maintain the heap property
-        fixHeap(node, true);
+/// @brief Writes the extreme value of every window of windowSize contiguous values to the output
+/// buffer
+/// @param out Receives count - windowSize + 1 values
+/// @return The number of values written
+template<typename TValue, typename TCompare>
+int slidingWindowExtreme(const TValue* values, int count, int windowSize, TValue* out)
+{
+    int written = 0;
+    forEachWindowExtreme<TValue, TCompare>(values, count, windowSize, [&](TValue value) {
+        out[written++] = value;
+    });
+
+    return written;
+}
 
-        return *node;
-    }
+/// @brief Writes the max value of every window of windowSize contiguous values to the output buffer
+/// @return The number of values written, count - windowSize + 1
+template<typename TValue>
+int slidingWindowMax(const TValue* values, int count, int windowSize, TValue* out)
+{
+    return slidingWindowExtreme<TValue, std::greater<TValue>>(values, count, windowSize, out);
+}
 
-    /// @brief Updates the value in the specified node, fixing up the heap to maintain the heap
-    /// property
-    /// @param node The node to update
-    /// @param value The new value
-    void update(BinaryHeapNode<TValue>& node, TValue value)
-    {
-        auto oldValue = node.value;
+/// @brief Writes the min value of every window of windowSize contiguous values to the output buffer
+/// @return The number of values written, count - windowSize + 1
+template<typename TValue>
+int slidingWindowMin(const TValue* values, int count, int windowSize, TValue* out)
+{
+    return slidingWindowExtreme<TValue, std::less<TValue>>(values, count, windowSize, out);
+}
 
-        // dont need to do anything if value is the same
-        if (value != oldValue)
+/// @brief Writes both the min and max value of every window of windowSize contiguous values to
+/// the output buffers in a single pass
+/// @return The number of values written to each buffer, count - windowSize + 1
+template<typename TValue>
+int slidingWindowMinMax(const TValue* values, int count, int windowSize, TValue* minOut, TValue* maxOut)
+{
+    SlidingWindowExtremes<TValue> window(windowSize);
+    int written = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        window.add(values[i]);
+        if (i >= (windowSize - 1))
         {
-            bool moveUp = shouldMoveUp(value, oldValue);
-            node.value = value;
-            fixHeap(&node, moveUp);
+            minOut[written] = window.getMin();
+            maxOut[written] = window.getMax();
+            written++;
         }
     }
 
-    /// @brief Swaps the root of this heap with the root of the other heap, fixing up both heaps to
-    /// maintain the heap property.
-    /// @param otherHeap The other heap to swap roots with
-    void swapRoot(BinaryHeap<TValue>& otherHeap)
+    return written;
+}
+
+class IntegerWriter {
+public:
+    // copy and move constructor and assignment not implemented
+    IntegerWriter(const IntegerWriter&)=delete;
+    IntegerWriter& operator=(const IntegerWriter&)=delete;
+    IntegerWriter(const IntegerWriter&&)=delete;
+    IntegerWriter& operator=(const IntegerWriter&&)=delete;
+
+    /// @brief Constructs a writer that formats integers into a reusable buffer and hands the
+    /// buffer to the stream in large writes, instead of formatting each value through the stream.
+    /// Not meant to be mixed with other writes to the same stream until flushed.
+    /// @param stream The stream to write to
+    /// @param bufferSize The number of bytes to collect before writing to the stream
+    IntegerWriter(ostream& stream, int bufferSize = 1 << 16) :
+        stream{stream},
+        buffer{},
+        used{0}
     {
-        auto ourRootPtr = getRoot();
-        auto theirRootPtr = otherHeap.getRoot();
-        if ((ourRootPtr == nullptr) || (theirRootPtr == nullptr))
+        if (bufferSize < MaxFormattedLength)
         {
-            throw std::runtime_error("One of the heaps is empty! Can't swap roots");
+            throw std::out_of_range("Buffer size must fit at least one formatted integer");
         }
 
-        // perform the swap. first update the heap each node is pointing to, then swap the actual
-        // root nodes in the underlying vector
-        std::swap(ourRootPtr->heap, theirRootPtr->heap);
-        std::swap(heap[0], otherHeap.heap[0]);
+        buffer.resize(bufferSize);
+    }
 
-        // now fix up the heaps
-        fixHeap(heap[0], false);
-        otherHeap.fixHeap(otherHeap.heap[0], false);
+    /// @brief Flushes any buffered output
+    ~IntegerWriter()
+    {
+        flush();
     }
 
-    /// @brief Returns the root node or a nullptr if the heap is empty
-    /// @return 
-    BinaryHeapNode<TValue>* getRoot() const
+    /// @brief Formats an integer into the buffer
+    /// @param value 
+    template<typename TInteger>
+    void write(TInteger value)
     {
-        BinaryHeapNode<TValue>* result = nullptr;
+        static_assert(std::is_integral<TInteger>::value, "Only integers can be written");
 
-        if (size() > 0)
-        {
-            result = heap[0];
-        }
+        reserve(MaxFormattedLength);
+        char* begin = buffer.data() + used;
+        auto result = std::to_chars(begin, buffer.data() + buffer.size(), value);
+        used += static_cast<int>(result.ptr - begin);
+    }
 
-        return result;
+    /// @brief Copies a character into the buffer
+    /// @param character 
+    void write(char character)
+    {
+        reserve(1);
+        buffer[used++] = character;
     }
 
-    /// @brief Destroys a binary heap
-    ~BinaryHeap()
+    /// @brief Writes the buffered output to the stream
+    void flush()
     {
-        // need to clean up the dynamically allocated nodes
-        for (auto node: heap)
+        if (used > 0)
         {
-            delete node;
+            stream.write(buffer.data(), used);
+            used = 0;
         }
     }
 
 private:
-    bool isMaxHeap;
-    // TODO: use unique pointer and remove associated destructor code
-    /// @brief The underlying heap vector. A vector of pointers to nodes.
-    std::vector<BinaryHeapNode<TValue>*> heap;
-
-    /// @brief fixes up the heap when a node's value is changed
-    /// @param node The node that was updated
-    /// @param moveUp Indicates if the node should be sifted up or down
-    void fixHeap(BinaryHeapNode<TValue>* node, bool moveUp)
+    /// @brief Enough for any 64 bit integer, including the sign
+    static constexpr int MaxFormattedLength = 20;
+
+    ostream& stream;
+    vector<char> buffer;
+    int used;
+
+    /// @brief Flushes the buffer if it doesn't have room for the specified number of characters
+    /// @param length 
+    void reserve(int length)
     {
-        bool continueSwapping = true;
-        while (continueSwapping)
+        if ((used + length) > static_cast<int>(buffer.size()))
         {
-            auto swapWith = moveUp
-                ? getSwapUp(node)
-                : getSwapDown(node);
-            
-            if (swapWith != nullptr)
-            {
-                swapNodes(node, swapWith);
-            }
-            else
-            {
-                continueSwapping = false;
-            }
+            flush();
         }
     }
+};
 
-    /// @brief Swaps the position of two nodes in the heap
-    /// @param node 
-    /// @param otherNode 
-    void swapNodes(BinaryHeapNode<TValue>* node, BinaryHeapNode<TValue>* otherNode)
-    {
-        // update the indexes first then swap the underlying pointers in the vector
-        std::swap(node->index, otherNode->index);
-        std::swap(heap[node->index], heap[otherNode->index]);
-    }
+// for every contiguous subsequence of size k in the input array of size n, print the max
+// integer in that subsequence. k is always <= n, k and n are always >= 1.
+void printKMax(int arr[], int n, int k){
 
-    /// @brief Returns the parent node of the specified node if the node needs to be moved up to satisfy
-    /// the heap property. Returns nullptr if the node does not need to be moved up.
-    /// @param node 
-    /// @return 
-    BinaryHeapNode<TValue>* getSwapUp(BinaryHeapNode<TValue>* node)
-    {
-        BinaryHeapNode<TValue>* result = nullptr;
+    IntegerWriter writer(cout);
+    forEachWindowMax(arr, n, k, [&](int value) {
+        writer.write(value);
+        writer.write(' ');
+    });
+    writer.write('\n');
+}
 
-        auto parent = getParent(node);
-        if (parent != nullptr)
-        {
-            bool shouldMove = shouldMoveUp(node->value, parent->value);
-            if (shouldMove)
-            {
-                result = parent;
-            }
-        }
+#ifdef BENCHMARK
 
-        return result;
-    }
+// Benchmark harness, build with -DBENCHMARK. Every benchmark reports the time per operation,
+// throughput and the number of heap allocations per operation.
 
-    /// @brief Returns the child node of the specified node if the node needs to be moved down to
-    /// satisfy the heap property. Returns nullptr if the node does not need to be moved down.
-    /// @param node 
-    /// @return 
-    BinaryHeapNode<TValue>* getSwapDown(BinaryHeapNode<TValue>* node)
-    {
-        BinaryHeapNode<TValue>* result = nullptr;
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
 
-        auto candidateChild = getMaxOrMinChild(node);
-        if (candidateChild != nullptr)
-        {
-            bool shouldMove = shouldMoveDown(node->value, candidateChild->value);
-            if (shouldMove)
-            {
-                result = candidateChild;
-            }
-        }
+static std::atomic<long long> allocationCount{0};
 
-        return result;
-    }
-    
-    /// @brief Indicates if the first value should be moved up in the heap, relative to the second value, to
-    /// satisfy the heap property.
-    /// @param firstValue 
-    /// @param secondValue 
-    /// @return 
-    bool shouldMoveUp(TValue firstValue, TValue secondValue)
+// replace the global allocation functions to count allocations. they are kept out of line so the
+// compiler doesn't pair the inlined malloc() and free() calls with new and delete and warn.
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* result = std::malloc((size > 0) ? size : 1);
+    if (result == nullptr)
     {
-        return isMaxHeap
-            ? (firstValue > secondValue)
-            : (firstValue < secondValue);
+        throw std::bad_alloc();
     }
+    return result;
+}
 
-    /// @brief Indicates if the first value should be moved down in the heap, relative to the second value, to
-    /// satisfy the heap property.
-    /// @param firstValue 
-    /// @param secondValue 
-    /// @return 
-    bool shouldMoveDown(TValue firstValue, TValue secondValue)
-    {
-        return isMaxHeap
-            ? (firstValue < secondValue)
-            : (firstValue > secondValue);
-    }
+__attribute__((noinline)) void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
 
-    /// @brief Returns the parent of a given node, or nullptr if the node is the root node
-    /// @param node The node to get the parent for
-    /// @return Pointer to parent node or nullptr if no parent
-    BinaryHeapNode<TValue>* getParent(BinaryHeapNode<TValue>* node)
-    {
-        BinaryHeapNode<TValue>* result = nullptr;
-        int nodeIndex = node->index;
+__attribute__((noinline)) void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
 
-        if (nodeIndex > 0)
-        {
-            // even indexed nodes are always righthand children.
-            bool isEven = ((nodeIndex % 2) == 0);
-            int offset = isEven ? 1 : 0;
-            int parentIndex = (nodeIndex - offset - 1) / 2;
+enum class Distribution {
+    Uniform,
+    Ascending,
+    Descending
+};
 
-            result = heap[parentIndex];
-        }
+static Distribution parseDistribution(const char* name)
+{
+    Distribution result = Distribution::Uniform;
 
-        return result;
+    if (std::strcmp(name, "ascending") == 0)
+    {
+        result = Distribution::Ascending;
     }
-    
-    /// @brief Returns the left child of a given node, or nullptr if the node doesnt have a left child
-    /// @param node The node to get the left child of
-    /// @return Pointer to left child node or nullptr if no left child
-    BinaryHeapNode<TValue>* getLeftChild(BinaryHeapNode<TValue>* node)
+    else if (std::strcmp(name, "descending") == 0)
     {
-        BinaryHeapNode<TValue>* result = nullptr;
-        int nodeIndex = node->index;
-        int halfCapacity = capacity() / 2;
+        result = Distribution::Descending;
+    }
+    else if (std::strcmp(name, "uniform") != 0)
+    {
+        throw std::invalid_argument("Distribution must be uniform, ascending or descending");
+    }
+
+    return result;
+}
 
-        // a crude check to avoid integer overflow
-        if (nodeIndex < halfCapacity)
+/// @brief Generates benchmark input values between 0 and maxValue
+/// @param count The number of values to generate
+/// @param distribution uniform random, ascending (every value evicts the whole window from the
+/// deque) or descending (every value stays queued until it leaves the window, the worst case
+/// for the deque's length)
+/// @param maxValue The largest value to generate
+/// @return 
+static std::vector<int> generateValues(int count, Distribution distribution, int maxValue)
+{
+    std::vector<int> result(count);
+    std::mt19937 generator{12345};
+
+    switch (distribution)
+    {
+    case Distribution::Uniform:
         {
-            // odd indexed nodes are always lefthand children.
-            int childIndex = (nodeIndex * 2) + 1;
-            if (childIndex < size())
+            std::uniform_int_distribution<int> uniform{0, maxValue};
+            for (auto& value : result)
             {
-                result = heap[childIndex];
+                value = uniform(generator);
             }
         }
-
-        return result;
+        break;
+    case Distribution::Ascending:
+    case Distribution::Descending:
+        for (int i = 0; i < count; i++)
+        {
+            int rank = (distribution == Distribution::Ascending) ? i : (count - 1 - i);
+            result[i] = static_cast<int>((static_cast<long long>(rank) * maxValue) / std::max(1, count - 1));
+        }
+        break;
     }
 
-    /// @brief Returns the right child of a given node, or nullptr if the node doesnt have a right child
-    /// @param node The node to get the right child of
-    /// @return Pointer to right child node or nullptr if no right child
-    BinaryHeapNode<TValue>* getRightChild(BinaryHeapNode<TValue>* node)
-    {
-        BinaryHeapNode<TValue>* result = nullptr;
-        int nodeIndex = node->index;
-        int halfCapacity = capacity() / 2;
+    return result;
+}
 
-        // a crude check to avoid integer overflow
-        if (nodeIndex < halfCapacity)
-        {
-            // even indexed nodes are always righthand children.
-            int childIndex = (nodeIndex * 2) + 2;
-            if (childIndex < size())
-            {
-                result = heap[childIndex];
-            }
-        }
+/// @brief Stops the compiler from optimizing away benchmark results
+static volatile long long benchmarkSink = 0;
+
+/// @brief Runs a benchmark once and prints ns/op, throughput and allocations/op
+/// @param name The name of the benchmark
+/// @param operations The number of operations performed by the benchmark body
+/// @param body The code to measure
+template<typename TBody>
+static void runBenchmark(const char* name, long long operations, TBody&& body)
+{
+    long long allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+
+    body();
+
+    auto end = std::chrono::steady_clock::now();
+    long long allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+    double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+    double ops = static_cast<double>(std::max(1LL, operations));
+
+    std::printf("%-40s %10.2f ns/op %10.2f Mops/s %8.3f allocs/op\n",
+        name,
+        nanoseconds / ops,
+        (ops * 1000.0) / std::max(1.0, nanoseconds),
+        allocations / ops);
+}
 
-        return result;
-    }
-    
-    /// @brief Gets the child with the greater value (if max heap) or smaller value (min heap). Returns
-    /// nullptr if the node does not have any children.
-    /// @param node The node to get the max child for
-    /// @return 
-    BinaryHeapNode<TValue>* getMaxOrMinChild(BinaryHeapNode<TValue>* node)
+/// @brief A stream buffer that discards everything written to it, so printKMax can be measured
+/// without the cost of a terminal or file
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override
     {
-        BinaryHeapNode<TValue>* result = nullptr;
-        auto leftChild = getLeftChild(node);
-        auto rightChild = getRightChild(node);
-
-        if (leftChild == nullptr)
-        {
-            // right child may still be null, but thats ok, returning nullptr indicates no children
-            result = rightChild;
-        }
-        else if (rightChild == nullptr)
-        {
-            // left child may still be null, but thats ok, returning nullptr indicates no children
-            result = leftChild;
-        }
-        else
-        {
-            // use the largest child for max heap and smallest for min heap
-            bool useLeftChild = shouldMoveUp(leftChild->value, rightChild->value);
-            result = useLeftChild ? leftChild : rightChild;
-        }
+        return c;
+    }
 
-        return result;
+    std::streamsize xsputn(const char*, std::streamsize count) override
+    {
+        return count;
     }
 };
 
-// for every contiguous subsequence of size k in the input array of size n, print the max
-// integer in that subsequence. k is always <= n, k and n are always >= 1.
-void printKMax(int arr[], int n, int k){
+int main(int argc, char* argv[])
+{
+    // usage: deque_stl [n] [k] [uniform|ascending|descending] [max value]
+    int n = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    int k = (argc > 2) ? std::atoi(argv[2]) : 1000;
+    Distribution distribution = (argc > 3) ? parseDistribution(argv[3]) : Distribution::Uniform;
+    int maxValue = (argc > 4) ? std::atoi(argv[4]) : 1000000;
+    if ((n < 1) || (k < 1) || (k > n) || (maxValue < 0))
+    {
+        throw std::out_of_range("n and k must be at least 1, k at most n and max value not negative");
+    }
 
-    BinaryHeap<int> maxHeap(true, k);
-    deque<BinaryHeapNode<int>*> samples;
+    std::vector<int> values = generateValues(n, distribution, maxValue);
+    std::printf("n=%d k=%d max value=%d\n", n, k, maxValue);
 
-    for (int i = 0; i < n; i++)
-    {
-        auto sample = arr[i];
+    std::vector<int> minima(n - k + 1);
+    std::vector<int> maxima(n - k + 1);
 
-        if (i >= k)
-        {
-            // reached max array size, update first element and move to back
-            BinaryHeapNode<int>& node{*samples.front()};
-            maxHeap.update(node, sample);
-            samples.pop_front();
-            samples.push_back(&node);
-        }
-        else
-        {
-            BinaryHeapNode<int>& node{maxHeap.add(sample)};
-            samples.push_back(&node);
-        }
+    runBenchmark("slidingWindowMax", n, [&]() {
+        benchmarkSink = slidingWindowMax(values.data(), n, k, maxima.data());
+    });
 
-        if (samples.size() == k)
-        {
-            cout << maxHeap.getRoot()->value;
-            cout << ' ';
-        }
-    }
-    cout << '\n';
+    runBenchmark("slidingWindowMinMax", n, [&]() {
+        benchmarkSink = slidingWindowMinMax(values.data(), n, k, minima.data(), maxima.data());
+    });
+
+    NullBuffer nullBuffer;
+    auto coutBuffer = cout.rdbuf(&nullBuffer);
+
+    runBenchmark("printKMax", n, [&]() {
+        printKMax(values.data(), n, k);
+    });
+
+    cout.rdbuf(coutBuffer);
+
+    return 0;
 }
+
+#endif
@@ -5,8 +5,17 @@
 #include <map>
 #include <string>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <set>
 #include <cassert>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <stdexcept>
 using namespace std;
 
 /* START HACKERRANK PROVIDED CODE - CANT EDIT */
@@ -32,119 +41,1877 @@ class Cache{
 };
 /* END HACKERRANK PROVIDED CODE - CANT EDIT */
 
+/// @brief Scrambles the key bits so nearby keys don't cluster in a hash index (murmur3 finalizer).
+/// The low bits pick a slot in a cache's index and the high bits pick a shard.
+/// @param key 
+/// @return 
+static uint32_t hash_key(int key)
+{
+    uint32_t result = static_cast<uint32_t>(key);
+    result ^= result >> 16;
+    result *= 0x85ebca6bu;
+    result ^= result >> 13;
+    result *= 0xc2b2ae35u;
+    result ^= result >> 16;
+    return result;
+}
+
+/// @brief The entry number used for empty index slots and missing list links
+static constexpr uint32_t NoEntry = UINT32_MAX;
+
+class KeyIndex {
+public:
+    /// @brief Constructs an open addressing hash index mapping keys to entry numbers in a cache's
+    /// entry pool. Uses linear probing and is sized to a power of two at least twice the
+    /// capacity, so it's at most half full and probe sequences stay short.
+    /// @param capacity The maximum number of keys in the index
+    KeyIndex(int capacity) :
+        slots{},
+        slotMask{0}
+    {
+        uint32_t slotCount = 2;
+        while (slotCount < (2 * static_cast<uint32_t>(capacity)))
+        {
+            slotCount *= 2;
+        }
+
+        slots.assign(slotCount, Slot{0, NoEntry});
+        slotMask = slotCount - 1;
+    }
+
+    /// @brief Returns the slot holding the key, or the empty slot where it would be inserted
+    /// @param key 
+    /// @return 
+    uint32_t find_slot(int key) const
+    {
+        uint32_t slot = hash_key(key) & slotMask;
+        while ((slots[slot].entry != NoEntry) && (slots[slot].key != key))
+        {
+            slot = (slot + 1) & slotMask;
+        }
+        return slot;
+    }
+
+    /// @brief Asks the CPU to start loading the slot a key's probe sequence starts at
+    /// @param key 
+    void prefetch(int key) const
+    {
+        __builtin_prefetch(&slots[hash_key(key) & slotMask]);
+    }
+
+    /// @brief Returns the entry stored in a slot, or NoEntry if the slot is empty
+    /// @param slot 
+    /// @return 
+    uint32_t get_entry(uint32_t slot) const
+    {
+        return slots[slot].entry;
+    }
+
+    /// @brief Returns the entry for a key, or NoEntry if the key isn't in the index
+    /// @param key 
+    /// @return 
+    uint32_t find(int key) const
+    {
+        return slots[find_slot(key)].entry;
+    }
+
+    /// @brief Returns the entry for a key like find, but may run while one writer changes the
+    /// index. Slots are read with relaxed atomic loads, so the result can be stale or torn and
+    /// must be validated by the caller, e.g. with a seqlock.
+    /// @param key 
+    /// @return 
+    uint32_t find_concurrent(int key) const
+    {
+        uint32_t slot = hash_key(key) & slotMask;
+        // a concurrent erase can shift keys around mid probe, so bound the probe by the table
+        for (uint32_t probes = 0; probes <= slotMask; probes++)
+        {
+            uint32_t entry = __atomic_load_n(&slots[slot].entry, __ATOMIC_RELAXED);
+            if ((entry == NoEntry) || (__atomic_load_n(&slots[slot].key, __ATOMIC_RELAXED) == key))
+            {
+                return entry;
+            }
+            slot = (slot + 1) & slotMask;
+        }
+        return NoEntry;
+    }
+
+    /// @brief Stores a key in an empty slot returned by find_slot
+    /// @param slot 
+    /// @param key 
+    /// @param entry 
+    void insert_at(uint32_t slot, int key, uint32_t entry)
+    {
+        store(slot, key, entry);
+    }
+
+    /// @brief Removes a key from the index, shifting later keys in the same probe sequence back so
+    /// lookups never stop early at the hole. Any slot numbers returned before are invalidated.
+    /// @param key A key in the index
+    void erase(int key)
+    {
+        uint32_t hole = find_slot(key);
+        uint32_t next = (hole + 1) & slotMask;
+
+        while (slots[next].entry != NoEntry)
+        {
+            // a key can fill the hole if the hole lies between its home slot and its current slot
+            uint32_t home = hash_key(slots[next].key) & slotMask;
+            uint32_t distanceToNext = (next - home) & slotMask;
+            uint32_t distanceToHole = (hole - home) & slotMask;
+            if (distanceToHole < distanceToNext)
+            {
+                store(hole, slots[next].key, slots[next].entry);
+                hole = next;
+            }
+            next = (next + 1) & slotMask;
+        }
+
+        __atomic_store_n(&slots[hole].entry, NoEntry, __ATOMIC_RELAXED);
+    }
+
+private:
+    /// @brief A hash index slot. The key is copied into the slot so probing doesn't have to
+    /// visit the entry pool.
+    struct Slot {
+        int key;
+        uint32_t entry;
+    };
+
+    std::vector<Slot> slots;
+    uint32_t slotMask;
+
+    /// @brief Writes a slot with relaxed atomic stores, so find_concurrent can read it while it
+    /// changes. The one writer still reads slots with plain loads.
+    void store(uint32_t slot, int key, uint32_t entry)
+    {
+        __atomic_store_n(&slots[slot].key, key, __ATOMIC_RELAXED);
+        __atomic_store_n(&slots[slot].entry, entry, __ATOMIC_RELAXED);
+    }
+};
+
+class FrequencySketch {
+public:
+    /// @brief Constructs a count-min sketch estimating how often each key was seen recently.
+    /// Every key maps to one 4 bit counter in each of four rows, and its estimate is the smallest
+    /// of those counters. After ten times the capacity increments all counters are halved, so
+    /// keys that were popular a long time ago age out.
+    /// @param capacity The capacity of the cache the sketch is for
+    FrequencySketch(int capacity) :
+        words{},
+        counterMask{0},
+        additions{0},
+        sampleSize{10 * std::max(1, capacity)}
+    {
+        // four counters per cached item, sixteen counters per word
+        uint32_t counterCount = 64;
+        while (counterCount < (4 * static_cast<uint32_t>(std::max(1, capacity))))
+        {
+            counterCount *= 2;
+        }
+
+        words.assign(counterCount / 16, 0);
+        counterMask = counterCount - 1;
+    }
+
+    /// @brief Records an access to a key
+    /// @param key 
+    void increment(int key)
+    {
+        for (int row = 0; row < Rows; row++)
+        {
+            uint32_t counter = get_counter(key, row);
+            uint64_t& word = words[counter / 16];
+            int shift = (counter % 16) * 4;
+            if (((word >> shift) & 0xf) < 0xf)
+            {
+                word += uint64_t{1} << shift;
+            }
+        }
+
+        additions++;
+        if (additions == sampleSize)
+        {
+            age();
+        }
+    }
+
+    /// @brief Returns the estimated number of recent accesses to a key, at most 15
+    /// @param key 
+    /// @return 
+    int estimate(int key) const
+    {
+        int result = 0xf;
+
+        for (int row = 0; row < Rows; row++)
+        {
+            uint32_t counter = get_counter(key, row);
+            int count = (words[counter / 16] >> ((counter % 16) * 4)) & 0xf;
+            result = std::min(result, count);
+        }
+
+        return result;
+    }
+
+private:
+    static constexpr int Rows = 4;
+
+    std::vector<uint64_t> words;
+    uint32_t counterMask;
+    int additions;
+    int sampleSize;
+
+    /// @brief Returns the counter for a key in a row using double hashing
+    /// @param key 
+    /// @param row 
+    /// @return 
+    uint32_t get_counter(int key, int row) const
+    {
+        uint32_t first = hash_key(key);
+        uint32_t second = hash_key(key ^ 0x9e3779b9) | 1;
+        return (first + (row * second)) & counterMask;
+    }
+
+    /// @brief Halves every counter
+    void age()
+    {
+        for (auto& word : words)
+        {
+            word = (word >> 1) & 0x7777777777777777ull;
+        }
+        additions /= 2;
+    }
+};
+
+/// @brief A snapshot of a cache's counters
+struct CacheStatistics {
+    /// @brief The number of latency histogram buckets. Bucket i counts operations that took
+    /// between 2^i and 2^(i+1) - 1 nanoseconds, the last bucket counts anything longer.
+    static constexpr int LatencyBuckets = 32;
+
+    long long hits;
+    long long misses;
+    long long inserts;
+    long long updates;
+    long long evictions;
+    // new items dropped by the admission filter
+    long long rejections;
+    // latency of the sampled get and set calls
+    std::array<long long, LatencyBuckets> latencies;
+
+    double hit_ratio() const
+    {
+        long long lookups = hits + misses;
+        return (lookups > 0) ? (static_cast<double>(hits) / lookups) : 0.0;
+    }
+
+    /// @brief Adds another cache's counts to these, e.g. to total the shards of a cache
+    /// @param other 
+    void add(const CacheStatistics& other)
+    {
+        hits += other.hits;
+        misses += other.misses;
+        inserts += other.inserts;
+        updates += other.updates;
+        evictions += other.evictions;
+        rejections += other.rejections;
+        for (int i = 0; i < LatencyBuckets; i++)
+        {
+            latencies[i] += other.latencies[i];
+        }
+    }
+};
+
+class CacheCounters {
+public:
+    /// @brief Constructs the counters for one cache. A cache only updates its counters from one
+    /// thread at a time (a sharded cache holds the shard lock), so counters are bumped with a
+    /// relaxed load and store instead of a locked read-modify-write, while snapshots can still be
+    /// taken from any thread. Latency sampling is off until enabled, and can be changed from any
+    /// thread too.
+    CacheCounters() :
+        counters{},
+        latencies{},
+        samplePeriod{0},
+        untilNextSample{0}
+    { }
+
+    void add_hit() { bump(counters[Hits]); }
+    void add_miss() { bump(counters[Misses]); }
+    void add_insert() { bump(counters[Inserts]); }
+    void add_update() { bump(counters[Updates]); }
+    void add_eviction() { bump(counters[Evictions]); }
+    void add_rejection() { bump(counters[Rejections]); }
+
+    /// @brief Enables timing of one in every period get and set calls
+    /// @param period The sampling period, or 0 to stop timing calls
+    void set_latency_sampling(int period)
+    {
+        untilNextSample.store(std::max(0, period), std::memory_order_relaxed);
+        samplePeriod.store(std::max(0, period), std::memory_order_relaxed);
+    }
+
+    /// @brief Indicates if the current call should be timed. Only costs a decrement and a branch
+    /// when sampling is enabled and a branch when it's not.
+    /// @return 
+    bool should_sample()
+    {
+        bool result = false;
+
+        int period = samplePeriod.load(std::memory_order_relaxed);
+        if (period > 0)
+        {
+            // a concurrent set_latency_sampling can leave the countdown at 0 or below, so restart
+            // it from there rather than only at exactly 0
+            int remaining = untilNextSample.load(std::memory_order_relaxed) - 1;
+            if (remaining <= 0)
+            {
+                remaining = period;
+                result = true;
+            }
+            untilNextSample.store(remaining, std::memory_order_relaxed);
+        }
+
+        return result;
+    }
+
+    /// @brief Adds a timed call to the latency histogram
+    /// @param nanoseconds 
+    void add_latency(long long nanoseconds)
+    {
+        int bucket = 0;
+        while ((nanoseconds > 1) && (bucket < (CacheStatistics::LatencyBuckets - 1)))
+        {
+            nanoseconds >>= 1;
+            bucket++;
+        }
+        bump(latencies[bucket]);
+    }
+
+    CacheStatistics snapshot() const
+    {
+        CacheStatistics result{};
+        result.hits = counters[Hits].load(std::memory_order_relaxed);
+        result.misses = counters[Misses].load(std::memory_order_relaxed);
+        result.inserts = counters[Inserts].load(std::memory_order_relaxed);
+        result.updates = counters[Updates].load(std::memory_order_relaxed);
+        result.evictions = counters[Evictions].load(std::memory_order_relaxed);
+        result.rejections = counters[Rejections].load(std::memory_order_relaxed);
+        for (int i = 0; i < CacheStatistics::LatencyBuckets; i++)
+        {
+            result.latencies[i] = latencies[i].load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    void reset()
+    {
+        for (auto& counter : counters)
+        {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        for (auto& latency : latencies)
+        {
+            latency.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    enum Counter {
+        Hits,
+        Misses,
+        Inserts,
+        Updates,
+        Evictions,
+        Rejections,
+        CounterCount
+    };
+
+    std::array<std::atomic<long long>, CounterCount> counters;
+    std::array<std::atomic<long long>, CacheStatistics::LatencyBuckets> latencies;
+    std::atomic<int> samplePeriod;
+    std::atomic<int> untilNextSample;
+
+    static void bump(std::atomic<long long>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+};
+
+class LatencySample {
+public:
+    /// @brief Times the enclosing scope if the counters say this call should be sampled
+    /// @param counters 
+    LatencySample(CacheCounters& counters) :
+        counters{counters},
+        sampled{counters.should_sample()},
+        start{}
+    {
+        if (sampled)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~LatencySample()
+    {
+        if (sampled)
+        {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            counters.add_latency(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+
+private:
+    CacheCounters& counters;
+    bool sampled;
+    std::chrono::steady_clock::time_point start;
+};
+
 class LRUCache : public Cache {
 public:
-    LRUCache(int capacity) {
+    /// @brief Indicates get changes the cache state, so concurrent gets must be serialized
+    static constexpr bool LockFreeGet = false;
+
+    /// @brief Constructs an LRU cache. Entries live in a pool allocated up front and are linked
+    /// into the recency list by 32 bit indexes. Keys are found through an open addressing hash
+    /// index, so get and set are constant time and never allocate. The map and node pointers
+    /// inherited from Cache are not used.
+    /// @param capacity The maximum number of items in the cache
+    /// @param useAdmissionFilter When true, a new key is only added to a full cache if a
+    /// frequency sketch estimates it has been accessed more often than the item it would evict
+    /// (TinyLFU). A scan of keys seen once then can't flush the frequently used items.
+    LRUCache(int capacity, bool useAdmissionFilter = false) :
+        entries{},
+        index(std::max(1, capacity)),
+        admissionFilter{},
+        counters{},
+        oldest{NoEntry},
+        newest{NoEntry}
+    {
+        if (capacity < 1)
+        {
+            throw std::out_of_range("Capacity must be greater than 0");
+        }
+
         mp = {};
         cp = capacity;
         head = NULL;
         tail = NULL;
-    }
 
-    ~LRUCache()
-    {
-        auto node = head;
-        while (node != NULL)
+        entries.reserve(capacity);
+        if (useAdmissionFilter)
         {
-            auto nodeToDelete = node;
-            node = node->next;
-            delete nodeToDelete;
+            admissionFilter = std::make_unique<FrequencySketch>(capacity);
         }
     }
 
+    /// @brief Returns a snapshot of the cache's hit, miss, insert, update, eviction and rejection
+    /// counts and its sampled latency histogram
+    /// @return 
+    CacheStatistics get_statistics() const
+    {
+        return counters.snapshot();
+    }
+
+    /// @brief Sets all counts and the latency histogram back to zero
+    void reset_statistics()
+    {
+        counters.reset();
+    }
+
+    /// @brief Times one in every period get and set calls for the latency histogram
+    /// @param period The sampling period, or 0 to stop timing calls
+    void set_latency_sampling(int period)
+    {
+        counters.set_latency_sampling(period);
+    }
+
     void set(int key, int value)
     {
-        auto item = mp.find(key);
+        LatencySample sample(counters);
+        uint32_t slot = index.find_slot(key);
+        record_access(key);
 
         // key not found, will add new item to cache
-        if (item == mp.end())
+        if (index.get_entry(slot) == NoEntry)
         {
-            // remove oldest item if cache is full
-            if (mp.size() == cp)
+            uint32_t entry;
+
+            if (entries.size() == static_cast<size_t>(cp))
+            {
+                // drop the new item instead if it isn't expected to be used more than the oldest
+                if (!should_admit(key, entries[oldest].key))
+                {
+                    counters.add_rejection();
+                    return;
+                }
+
+                // reuse the oldest entry if cache is full. removing its key may shift other keys
+                // back into earlier slots so the slot for the new key has to be found again.
+                entry = oldest;
+                index.erase(entries[entry].key);
+                remove_node(entry);
+                slot = index.find_slot(key);
+                counters.add_eviction();
+            }
+            else
             {
-                mp.erase(head->key);
-                remove_node(head, true);
+                entry = entries.size();
+                entries.push_back({});
             }
 
-            // add a new node to the end of the list
-            Node* newNode = new Node(key, value);
-            add_node(newNode);
-            mp[key] = newNode;
+            entries[entry].key = key;
+            entries[entry].value = value;
+            add_node(entry);
+            index.insert_at(slot, key, entry);
+            counters.add_insert();
         }
         else
         {
             // update existing item
-            auto node = item->second;
-            node->value = value;
+            uint32_t entry = index.get_entry(slot);
+            entries[entry].value = value;
             // touch the node to indicate it's the most recently accessed cache item
-            touch(node);
+            touch(entry);
+            counters.add_update();
         }
     }
     
+    /// @brief Looks up a batch of keys, giving the same results and recency order as calling get
+    /// for each key in turn. The index slots for a block of keys are prefetched first, then the
+    /// keys are looked up and their entries prefetched, and only then are values read and entries
+    /// touched, so the memory accesses for different keys overlap instead of stalling one by one.
+    /// @param keys The keys to look up
+    /// @param count The number of keys
+    /// @param out Receives the value for each key, or -1 if the key isn't in the cache
+    void get_many(const int* keys, int count, int* out)
+    {
+        uint32_t found[BatchBlockSize];
+
+        for (int blockStart = 0; blockStart < count; blockStart += BatchBlockSize)
+        {
+            int blockSize = std::min(BatchBlockSize, count - blockStart);
+            const int* blockKeys = keys + blockStart;
+
+            for (int i = 0; i < blockSize; i++)
+            {
+                index.prefetch(blockKeys[i]);
+            }
+
+            for (int i = 0; i < blockSize; i++)
+            {
+                found[i] = index.find(blockKeys[i]);
+                if (found[i] != NoEntry)
+                {
+                    __builtin_prefetch(&entries[found[i]]);
+                }
+            }
+
+            // lookups don't change the index, so resolving them all before touching any entry
+            // gives the same result as calling get in order
+            for (int i = 0; i < blockSize; i++)
+            {
+                int result = -1;
+                record_access(blockKeys[i]);
+                if (found[i] != NoEntry)
+                {
+                    result = entries[found[i]].value;
+                    touch(found[i]);
+                    counters.add_hit();
+                }
+                else
+                {
+                    counters.add_miss();
+                }
+                out[blockStart + i] = result;
+            }
+        }
+    }
+
+    /// @brief Sets a batch of items, giving the same result as calling set for each item in turn.
+    /// The index slots for a block of keys are prefetched before the items are set.
+    /// @param keys The keys to set
+    /// @param values The value for each key
+    /// @param count The number of items
+    void set_many(const int* keys, const int* values, int count)
+    {
+        for (int blockStart = 0; blockStart < count; blockStart += BatchBlockSize)
+        {
+            int blockSize = std::min(BatchBlockSize, count - blockStart);
+
+            for (int i = 0; i < blockSize; i++)
+            {
+                index.prefetch(keys[blockStart + i]);
+            }
+
+            // a set can insert or evict keys, changing the slots later keys resolve to, so the
+            // sets themselves have to run one after the other
+            for (int i = 0; i < blockSize; i++)
+            {
+                set(keys[blockStart + i], values[blockStart + i]);
+            }
+        }
+    }
+
     int get(int key)
     {
+        LatencySample sample(counters);
         int result = -1;
 
-        auto item = mp.find(key);
-        // key is found, set result to value contained in node
-        if (item != mp.end())
+        uint32_t entry = index.find(key);
+        record_access(key);
+        // key is found, set result to value contained in entry
+        if (entry != NoEntry)
         {
-            auto node = item->second;
-            result = node->value;
+            result = entries[entry].value;
             // touch the node to indicate it's the most recently accessed cache item
-            touch(node);
+            touch(entry);
+            counters.add_hit();
+        }
+        else
+        {
+            counters.add_miss();
         }
 
         return result;
     }
 
 private:
-    void remove_node(Node* node, bool deallocate)
+    /// @brief The number of keys in a batch whose memory accesses are overlapped
+    static constexpr int BatchBlockSize = 16;
+
+    /// @brief A cache item in the entry pool, linked into the recency list by index
+    struct Entry {
+        int key;
+        int value;
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    std::vector<Entry> entries;
+    KeyIndex index;
+    // access frequencies of recently seen keys, or nullptr when every new key is admitted
+    std::unique_ptr<FrequencySketch> admissionFilter;
+    CacheCounters counters;
+    // the least recently used entry, evicted first
+    uint32_t oldest;
+    // the most recently used entry
+    uint32_t newest;
+
+    void record_access(int key)
     {
-        if (node == head)
+        if (admissionFilter)
         {
-            head = head->next;
+            admissionFilter->increment(key);
         }
-        if (node == tail)
+    }
+
+    bool should_admit(int key, int victimKey) const
+    {
+        return !admissionFilter || (admissionFilter->estimate(key) > admissionFilter->estimate(victimKey));
+    }
+
+    void remove_node(uint32_t entry)
+    {
+        Entry& node = entries[entry];
+
+        if (entry == oldest)
         {
-            tail = tail->prev;
+            oldest = node.next;
         }
-        if (node->prev != NULL)
+        if (entry == newest)
         {
-            node->prev->next = node->next;
+            newest = node.prev;
         }
-        if (node->next != NULL)
+        if (node.prev != NoEntry)
         {
-            node->next->prev = node->prev;
+            entries[node.prev].next = node.next;
         }
-        
-        if (deallocate)
+        if (node.next != NoEntry)
         {
-            delete node;
+            entries[node.next].prev = node.prev;
         }
     }
     
-    void add_node(Node* node)
+    void add_node(uint32_t entry)
     {
-        node->prev = tail;
-        node->next = NULL;
+        Entry& node = entries[entry];
+        node.prev = newest;
+        node.next = NoEntry;
 
-        if (head == NULL)
+        if (oldest == NoEntry)
         {
-            head = node;
+            oldest = entry;
         }
-        if (tail != NULL)
+        if (newest != NoEntry)
         {
-            tail->next = node;
+            entries[newest].next = entry;
         }
 
-        tail = node;
+        newest = entry;
     }
 
-    void touch(Node* node)
+    void touch(uint32_t entry)
     {
         // move node to end of the list  
-        remove_node(node, false);
-        add_node(node);
+        if (entry != newest)
+        {
+            remove_node(entry);
+            add_node(entry);
+        }
+    }
+};
+
+class ClockCache : public Cache {
+public:
+    /// @brief Indicates get only reads the cache state (apart from an atomic reference bit) and
+    /// validates what it read with a seqlock, so gets may run without a lock, concurrently with
+    /// each other and with one set
+    static constexpr bool LockFreeGet = true;
+
+    /// @brief Constructs a cache that approximates LRU with the CLOCK algorithm. A hit only sets
+    /// the entry's reference bit instead of moving the entry in a recency list. When the cache is
+    /// full, a hand sweeps the entries in a circle clearing reference bits and evicts the first
+    /// entry whose bit is already clear, i.e. one not read since the hand last passed it.
+    /// @param capacity The maximum number of items in the cache
+    ClockCache(int capacity) :
+        entries{},
+        referenced{},
+        index(std::max(1, capacity)),
+        hand{0},
+        version{0}
+    {
+        if (capacity < 1)
+        {
+            throw std::out_of_range("Capacity must be greater than 0");
+        }
+
+        mp = {};
+        cp = capacity;
+        head = NULL;
+        tail = NULL;
+
+        entries.reserve(capacity);
+        referenced = std::make_unique<std::atomic<uint8_t>[]>(capacity);
+    }
+
+    /// @brief Adds or updates an item. Sets must not run concurrently with each other, but gets
+    /// may run concurrently with a set.
+    /// @param key 
+    /// @param value 
+    void set(int key, int value)
+    {
+        // an odd version tells concurrent gets a change is under way
+        uint32_t startVersion = version.load(std::memory_order_relaxed);
+        version.store(startVersion + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint32_t slot = index.find_slot(key);
+
+        // key not found, will add new item to cache
+        if (index.get_entry(slot) == NoEntry)
+        {
+            uint32_t entry;
+
+            if (entries.size() == static_cast<size_t>(cp))
+            {
+                entry = find_victim();
+                index.erase(entries[entry].key);
+                slot = index.find_slot(key);
+            }
+            else
+            {
+                entry = entries.size();
+                entries.push_back({});
+            }
+
+            __atomic_store_n(&entries[entry].key, key, __ATOMIC_RELAXED);
+            __atomic_store_n(&entries[entry].value, value, __ATOMIC_RELAXED);
+            referenced[entry].store(0, std::memory_order_relaxed);
+            index.insert_at(slot, key, entry);
+        }
+        else
+        {
+            // update existing item
+            uint32_t entry = index.get_entry(slot);
+            __atomic_store_n(&entries[entry].value, value, __ATOMIC_RELAXED);
+            mark_referenced(entry);
+        }
+
+        version.store(startVersion + 2, std::memory_order_release);
     }
-};
\ No newline at end of file
+
+    /// @brief Looks up an item without taking a lock or writing shared memory, apart from
+    /// setting a clear reference bit. The index and entry are read with relaxed atomic loads and
+    /// the read is retried if a set ran meanwhile, i.e. the version changed or was odd.
+    /// @param key 
+    /// @return The value, or -1 if the key isn't in the cache
+    int get(int key)
+    {
+        while (true)
+        {
+            uint32_t startVersion = version.load(std::memory_order_acquire);
+            if ((startVersion % 2) == 0)
+            {
+                int result = -1;
+                uint32_t entry = index.find_concurrent(key);
+                // key is found, set result to value contained in entry. the entry may have been
+                // reused for another key while the index was read.
+                bool isHit = (entry != NoEntry) && (__atomic_load_n(&entries[entry].key, __ATOMIC_RELAXED) == key);
+                if (isHit)
+                {
+                    result = __atomic_load_n(&entries[entry].value, __ATOMIC_RELAXED);
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (version.load(std::memory_order_relaxed) == startVersion)
+                {
+                    if (isHit)
+                    {
+                        mark_referenced(entry);
+                    }
+                    return result;
+                }
+            }
+
+            // a set is under way, give its thread a chance to finish it
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    /// @brief A cache item in the entry pool
+    struct Entry {
+        int key;
+        int value;
+    };
+
+    // reserved up front, so gets can index it while a set appends
+    std::vector<Entry> entries;
+    /// @brief One reference bit per entry, kept apart from the entries so they stay dense
+    std::unique_ptr<std::atomic<uint8_t>[]> referenced;
+    KeyIndex index;
+    uint32_t hand;
+    // seqlock version, odd while a set is changing the cache. on its own cache line so gets
+    // reading it don't share one with the entries a set writes
+    alignas(64) std::atomic<uint32_t> version;
+
+    void mark_referenced(uint32_t entry)
+    {
+        // only write when the bit is clear so hot entries don't keep dirtying the cache line
+        if (referenced[entry].load(std::memory_order_relaxed) == 0)
+        {
+            referenced[entry].store(1, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Sweeps the hand around the entries until it finds one that hasn't been referenced
+    /// since the hand last passed it. Ends within two laps.
+    /// @return The entry to evict
+    uint32_t find_victim()
+    {
+        while (referenced[hand].load(std::memory_order_relaxed) != 0)
+        {
+            referenced[hand].store(0, std::memory_order_relaxed);
+            hand = (hand + 1) % cp;
+        }
+
+        uint32_t victim = hand;
+        hand = (hand + 1) % cp;
+        return victim;
+    }
+};
+
+class TimingWheel {
+public:
+    /// @brief Constructs a hierarchical timing wheel for expiring cache entries. Each of the four
+    /// levels has 64 slots, a slot on level l covering 64^l ticks. A timer is put on the lowest
+    /// level whose range reaches its expiry and moved down a level each time the wheel reaches
+    /// its slot, so scheduling, cancelling and expiring a timer are constant time and advancing
+    /// only visits slots that are due, skipping over idle time in one step.
+    /// @param capacity The maximum number of timers, one per cache entry
+    /// @param now The current tick
+    TimingWheel(int capacity, long long now) :
+        slots(Levels * SlotsPerLevel, NoEntry),
+        timers(std::max(1, capacity), Timer{0, NoEntry, NoEntry, NoSlot}),
+        currentTick{now}
+    { }
+
+    /// @brief Schedules, or reschedules, the timer of an entry
+    /// @param entry The entry the timer belongs to
+    /// @param expiry The tick the entry expires at, must be after the current tick
+    void schedule(uint32_t entry, long long expiry)
+    {
+        cancel(entry);
+        timers[entry].expiry = expiry;
+        link(entry);
+    }
+
+    /// @brief Cancels the timer of an entry, if it has one
+    /// @param entry 
+    void cancel(uint32_t entry)
+    {
+        if (timers[entry].slot != NoSlot)
+        {
+            unlink(entry);
+        }
+    }
+
+    /// @brief Advances the wheel to the specified tick, calling onExpired for every entry whose
+    /// timer expires on the way. The callback may cancel other timers but must not schedule any.
+    /// @param now The current tick
+    /// @param onExpired Called with each expired entry
+    template<typename TCallback>
+    void advance(long long now, TCallback&& onExpired)
+    {
+        while (currentTick < now)
+        {
+            // ticks that neither expire nor cascade a timer change nothing, so jump straight to
+            // the next tick that does, or to now if none is due before it
+            long long dueTick = next_due_tick();
+            if (dueTick > now)
+            {
+                currentTick = now;
+                break;
+            }
+
+            currentTick = dueTick;
+
+            // when a lower level wraps around, move the timers in the next slot of the level
+            // above down to where they belong now. the highest level goes first so its timers
+            // can land in the slots cascaded after it.
+            for (int level = Levels - 1; level > 0; level--)
+            {
+                long long levelMask = (1LL << (SlotBits * level)) - 1;
+                if ((currentTick & levelMask) == 0)
+                {
+                    int slot = (level * SlotsPerLevel) + ((currentTick >> (SlotBits * level)) & SlotMask);
+                    uint32_t entry = detach(slot);
+                    while (entry != NoEntry)
+                    {
+                        uint32_t next = timers[entry].next;
+                        link(entry);
+                        entry = next;
+                    }
+                }
+            }
+
+            uint32_t entry = detach(currentTick & SlotMask);
+            while (entry != NoEntry)
+            {
+                uint32_t next = timers[entry].next;
+                onExpired(entry);
+                entry = next;
+            }
+        }
+    }
+
+private:
+    static constexpr int Levels = 4;
+    static constexpr int SlotBits = 6;
+    static constexpr int SlotsPerLevel = 1 << SlotBits;
+    static constexpr int SlotMask = SlotsPerLevel - 1;
+    static constexpr int NoSlot = -1;
+
+    /// @brief A timer, linked into the list of its wheel slot by entry number
+    struct Timer {
+        long long expiry;
+        uint32_t prev;
+        uint32_t next;
+        int slot;
+    };
+
+    // the first timer in each slot, level by level
+    std::vector<uint32_t> slots;
+    // a bit per slot that has timers, one word per level
+    std::array<uint64_t, Levels> occupied{};
+    std::vector<Timer> timers;
+    long long currentTick;
+
+    /// @brief Links a timer into the slot for its expiry, relative to the current tick
+    /// @param entry 
+    void link(uint32_t entry)
+    {
+        Timer& timer = timers[entry];
+        long long delta = std::max(0LL, timer.expiry - currentTick);
+
+        int level = 0;
+        while ((level < (Levels - 1)) && (delta >= (1LL << (SlotBits * (level + 1)))))
+        {
+            level++;
+        }
+
+        // timers past the range of the wheel wait in the furthest slot of the top level and are
+        // placed again when the wheel reaches it
+        long long tick = std::min(timer.expiry, currentTick + (1LL << (SlotBits * Levels)) - 1);
+        timer.slot = (level * SlotsPerLevel) + ((tick >> (SlotBits * level)) & SlotMask);
+        timer.prev = NoEntry;
+        timer.next = slots[timer.slot];
+        if (timer.next != NoEntry)
+        {
+            timers[timer.next].prev = entry;
+        }
+        slots[timer.slot] = entry;
+        occupied[level] |= uint64_t{1} << (timer.slot & SlotMask);
+    }
+
+    void unlink(uint32_t entry)
+    {
+        Timer& timer = timers[entry];
+
+        if (timer.prev == NoEntry)
+        {
+            slots[timer.slot] = timer.next;
+            if (timer.next == NoEntry)
+            {
+                occupied[timer.slot / SlotsPerLevel] &= ~(uint64_t{1} << (timer.slot & SlotMask));
+            }
+        }
+        else
+        {
+            timers[timer.prev].next = timer.next;
+        }
+        if (timer.next != NoEntry)
+        {
+            timers[timer.next].prev = timer.prev;
+        }
+        timer.slot = NoSlot;
+    }
+
+    /// @brief Returns the first tick after the current one at which advancing has work to do:
+    /// a level 0 slot with timers comes due, or a higher level slot with timers is cascaded
+    /// because the level below wraps around
+    /// @return LLONG_MAX if no timer is scheduled
+    long long next_due_tick() const
+    {
+        long long result = LLONG_MAX;
+        for (int level = 0; level < Levels; level++)
+        {
+            if (occupied[level] == 0)
+            {
+                continue;
+            }
+
+            // level 0 slots come due every tick, higher level slots when the level below wraps.
+            // rotate the occupied slots so the next one to come due is bit 0.
+            int shift = SlotBits * level;
+            long long first = ((currentTick >> shift) + 1) << shift;
+            int rotation = static_cast<int>((first >> shift) & SlotMask);
+            uint64_t pending = (occupied[level] >> rotation) | (occupied[level] << ((SlotsPerLevel - rotation) & SlotMask));
+            long long tick = first + (static_cast<long long>(__builtin_ctzll(pending)) << shift);
+            result = std::min(result, tick);
+        }
+        return result;
+    }
+
+    /// @brief Empties a slot, marking its timers as unscheduled
+    /// @param slot 
+    /// @return The first timer that was in the slot, the rest follow through next
+    uint32_t detach(int slot)
+    {
+        uint32_t first = slots[slot];
+        slots[slot] = NoEntry;
+        occupied[slot / SlotsPerLevel] &= ~(uint64_t{1} << (slot & SlotMask));
+
+        for (uint32_t entry = first; entry != NoEntry; entry = timers[entry].next)
+        {
+            timers[entry].slot = NoSlot;
+        }
+
+        return first;
+    }
+};
+
+/// @brief The default time source for WeightedTTLCache, milliseconds of the steady clock
+/// @return 
+static long long steady_milliseconds()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+class WeightedTTLCache : public Cache {
+public:
+    /// @brief Constructs an LRU cache bounded by the total cost of its items as well as their
+    /// number, where items can also expire after a time to live. Expired items are removed by a
+    /// timing wheel as time passes, never by scanning the recency list.
+    /// @param capacity The maximum number of items in the cache
+    /// @param maxCost The maximum total cost of the items in the cache, e.g. their size in bytes
+    /// @param clock Returns the current time in ticks, milliseconds of the steady clock by default
+    WeightedTTLCache(int capacity, long long maxCost, long long (*clock)() = steady_milliseconds) :
+        entries{},
+        index(std::max(1, capacity)),
+        wheel(capacity, clock()),
+        clock{clock},
+        maxCost{maxCost},
+        totalCost{0},
+        count{0},
+        freeEntries{NoEntry},
+        oldest{NoEntry},
+        newest{NoEntry}
+    {
+        if ((capacity < 1) || (maxCost < 1))
+        {
+            throw std::out_of_range("Capacity and max cost must be greater than 0");
+        }
+
+        mp = {};
+        cp = capacity;
+        head = NULL;
+        tail = NULL;
+
+        entries.reserve(capacity);
+    }
+
+    /// @brief Returns the number of items in the cache
+    /// @return 
+    int size() const
+    {
+        return count;
+    }
+
+    /// @brief Returns the total cost of the items in the cache
+    /// @return 
+    long long total_cost() const
+    {
+        return totalCost;
+    }
+
+    /// @brief Sets an item with a cost of 1 that never expires
+    void set(int key, int value)
+    {
+        set(key, value, 1, 0);
+    }
+
+    /// @brief Sets an item, evicting least recently used items until it fits. An item costing
+    /// more than the max cost is not cached, and replaces any item with the same key.
+    /// @param key 
+    /// @param value 
+    /// @param cost The cost of the item, e.g. its size in bytes
+    /// @param timeToLive The number of ticks until the item expires, or 0 if it never expires
+    void set(int key, int value, long long cost, long long timeToLive)
+    {
+        if ((cost < 0) || (timeToLive < 0))
+        {
+            throw std::out_of_range("Cost and time to live must not be negative");
+        }
+
+        long long now = clock();
+        expire(now);
+
+        uint32_t entry = index.find(key);
+        if (cost > maxCost)
+        {
+            if (entry != NoEntry)
+            {
+                remove_entry(entry);
+            }
+            return;
+        }
+
+        if (entry == NoEntry)
+        {
+            // make room for the new item
+            while ((count == cp) || ((totalCost + cost) > maxCost))
+            {
+                remove_entry(oldest);
+            }
+
+            entry = allocate_entry();
+            entries[entry].key = key;
+            entries[entry].cost = 0;
+            add_node(entry);
+            index.insert_at(index.find_slot(key), key, entry);
+            count++;
+        }
+        else
+        {
+            touch(entry);
+        }
+
+        Entry& item = entries[entry];
+        totalCost += cost - item.cost;
+        item.value = value;
+        item.cost = cost;
+        item.expiry = (timeToLive > 0) ? (now + timeToLive) : 0;
+        if (timeToLive > 0)
+        {
+            wheel.schedule(entry, item.expiry);
+        }
+        else
+        {
+            wheel.cancel(entry);
+        }
+
+        // an item that grew may push the total over the max. it's the most recently used item
+        // and fits on its own, so the loop stops before reaching it.
+        while (totalCost > maxCost)
+        {
+            remove_entry(oldest);
+        }
+    }
+
+    int get(int key)
+    {
+        int result = -1;
+
+        uint32_t entry = index.find(key);
+        if (entry != NoEntry)
+        {
+            // the wheel only runs on set, so an item can be past its expiry but still cached
+            long long expiry = entries[entry].expiry;
+            if ((expiry != 0) && (expiry <= clock()))
+            {
+                remove_entry(entry);
+            }
+            else
+            {
+                result = entries[entry].value;
+                touch(entry);
+            }
+        }
+
+        return result;
+    }
+
+    /// @brief Removes every item whose time to live has passed
+    void expire()
+    {
+        expire(clock());
+    }
+
+private:
+    /// @brief A cache item in the entry pool, linked into the recency list by index. Free entries
+    /// are linked through next.
+    struct Entry {
+        int key;
+        int value;
+        long long cost;
+        long long expiry;
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    std::vector<Entry> entries;
+    KeyIndex index;
+    TimingWheel wheel;
+    long long (*clock)();
+    long long maxCost;
+    long long totalCost;
+    int count;
+    uint32_t freeEntries;
+    // the least recently used entry, evicted first
+    uint32_t oldest;
+    // the most recently used entry
+    uint32_t newest;
+
+    void expire(long long now)
+    {
+        wheel.advance(now, [this](uint32_t entry) {
+            remove_entry(entry);
+        });
+    }
+
+    uint32_t allocate_entry()
+    {
+        uint32_t entry = freeEntries;
+
+        if (entry != NoEntry)
+        {
+            freeEntries = entries[entry].next;
+        }
+        else
+        {
+            entry = entries.size();
+            entries.push_back({});
+        }
+
+        return entry;
+    }
+
+    /// @brief Removes an item from the index, the recency list and the wheel and frees its entry
+    /// @param entry 
+    void remove_entry(uint32_t entry)
+    {
+        index.erase(entries[entry].key);
+        remove_node(entry);
+        wheel.cancel(entry);
+        totalCost -= entries[entry].cost;
+        count--;
+
+        entries[entry].next = freeEntries;
+        freeEntries = entry;
+    }
+
+    void remove_node(uint32_t entry)
+    {
+        Entry& node = entries[entry];
+
+        if (entry == oldest)
+        {
+            oldest = node.next;
+        }
+        if (entry == newest)
+        {
+            newest = node.prev;
+        }
+        if (node.prev != NoEntry)
+        {
+            entries[node.prev].next = node.next;
+        }
+        if (node.next != NoEntry)
+        {
+            entries[node.next].prev = node.prev;
+        }
+    }
+    
+    void add_node(uint32_t entry)
+    {
+        Entry& node = entries[entry];
+        node.prev = newest;
+        node.next = NoEntry;
+
+        if (oldest == NoEntry)
+        {
+            oldest = entry;
+        }
+        if (newest != NoEntry)
+        {
+            entries[newest].next = entry;
+        }
+
+        newest = entry;
+    }
+
+    void touch(uint32_t entry)
+    {
+        // move node to end of the list  
+        if (entry != newest)
+        {
+            remove_node(entry);
+            add_node(entry);
+        }
+    }
+};
+
+template<typename TCache>
+class ShardedCache : public Cache {
+public:
+    /// @brief Constructs a thread safe cache made of independently locked caches. Each key belongs
+    /// to one shard, picked by its hash, so threads working on different shards never contend.
+    /// Recency is tracked per shard, so the item evicted is the least recently used item of its
+    /// shard rather than of the whole cache. When the shard cache's get is lock free (see
+    /// ClockCache) gets don't take the shard lock at all, so reads neither exclude each other
+    /// nor write the lock's cache line.
+    /// @param capacity The maximum number of items in the cache, split evenly between the shards
+    /// @param shardCount The number of shards, rounded up to a power of two. Clamped to the
+    /// largest power of two no greater than the capacity.
+    ShardedCache(int capacity, int shardCount = 16) :
+        shards{},
+        shardBits{0}
+    {
+        if ((capacity < 1) || (shardCount < 1))
+        {
+            throw std::out_of_range("Capacity and shard count must be greater than 0");
+        }
+
+        mp = {};
+        cp = capacity;
+        head = NULL;
+        tail = NULL;
+
+        // 1 << 30 is the largest power of two an int holds, stop there rather than shift into
+        // the sign bit
+        int wantedShards = std::min(shardCount, capacity);
+        while ((shardBits < 30) && ((1 << shardBits) < wantedShards))
+        {
+            shardBits++;
+        }
+
+        // every shard holds at least one item, so there can't be more shards than items
+        while ((1 << shardBits) > capacity)
+        {
+            shardBits--;
+        }
+
+        // the first shards take one item each of the remainder, so the capacities add up to cp
+        int shardTotal = 1 << shardBits;
+        for (int i = 0; i < shardTotal; i++)
+        {
+            int shardCapacity = (capacity / shardTotal) + ((i < (capacity % shardTotal)) ? 1 : 0);
+            shards.push_back(std::make_unique<Shard>(shardCapacity));
+        }
+    }
+
+    /// @brief Returns the number of shards
+    /// @return 
+    int shard_count() const
+    {
+        return shards.size();
+    }
+
+    /// @brief Returns the statistics of all shards added together. The counters are atomic, so
+    /// no shard lock is taken, and a snapshot taken while other threads use the cache may be a
+    /// few operations behind.
+    /// @return 
+    CacheStatistics get_statistics() const
+    {
+        CacheStatistics result{};
+        for (const auto& shard : shards)
+        {
+            result.add(shard->cache.get_statistics());
+        }
+        return result;
+    }
+
+    /// @brief Sets the counts and latency histograms of all shards back to zero
+    void reset_statistics()
+    {
+        for (auto& shard : shards)
+        {
+            shard->cache.reset_statistics();
+        }
+    }
+
+    /// @brief Times one in every period get and set calls of each shard for the latency histogram
+    /// @param period The sampling period, or 0 to stop timing calls
+    void set_latency_sampling(int period)
+    {
+        for (auto& shard : shards)
+        {
+            shard->cache.set_latency_sampling(period);
+        }
+    }
+
+    void set(int key, int value)
+    {
+        Shard& shard = get_shard(key);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.cache.set(key, value);
+    }
+
+    int get(int key)
+    {
+        Shard& shard = get_shard(key);
+        if constexpr (TCache::LockFreeGet)
+        {
+            return shard.cache.get(key);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            return shard.cache.get(key);
+        }
+    }
+
+private:
+    /// @brief A cache and its lock, aligned to a cache line so neighbouring shards' locks don't
+    /// share one
+    struct alignas(64) Shard {
+        std::mutex lock;
+        TCache cache;
+
+        Shard(int capacity) :
+            lock{},
+            cache(capacity)
+        {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    int shardBits;
+
+    Shard& get_shard(int key)
+    {
+        // use the high hash bits, the low bits pick the slot inside the shard's index
+        uint32_t shard = (shardBits == 0) ? 0 : (hash_key(key) >> (32 - shardBits));
+        return *shards[shard];
+    }
+};
+
+using ShardedLRUCache = ShardedCache<LRUCache>;
+using ShardedClockCache = ShardedCache<ClockCache>;
+
+#ifdef BENCHMARK
+
+// Benchmark harness, build with -DBENCHMARK. Every benchmark reports the time per operation,
+// throughput and the number of heap allocations per operation.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <thread>
+
+static std::atomic<long long> allocationCount{0};
+
+// replace the global allocation functions to count allocations. they are kept out of line so the
+// compiler doesn't pair the inlined malloc() and free() calls with new and delete and warn.
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* result = std::malloc((size > 0) ? size : 1);
+    if (result == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+enum class Distribution {
+    Uniform,
+    Sequential,
+    Zipf
+};
+
+static Distribution parseDistribution(const char* name)
+{
+    Distribution result = Distribution::Uniform;
+
+    if (std::strcmp(name, "sequential") == 0)
+    {
+        result = Distribution::Sequential;
+    }
+    else if (std::strcmp(name, "zipf") == 0)
+    {
+        result = Distribution::Zipf;
+    }
+    else if (std::strcmp(name, "uniform") != 0)
+    {
+        throw std::invalid_argument("Distribution must be uniform, sequential or zipf");
+    }
+
+    return result;
+}
+
+/// @brief Generates a trace of benchmark keys between 0 and maxKey
+/// @param count The number of keys to generate
+/// @param distribution uniform random, sequential (cycles through every key in order, so a
+/// recency based cache smaller than the key space never hits) or zipf (key k is picked with a
+/// probability proportional to 1 / (k + 1), like real access traces with a few hot keys)
+/// @param maxKey The largest key to generate
+/// @return 
+static std::vector<int> generateValues(int count, Distribution distribution, int maxKey)
+{
+    std::vector<int> result(count);
+    std::mt19937 generator{12345};
+
+    switch (distribution)
+    {
+    case Distribution::Uniform:
+        {
+            std::uniform_int_distribution<int> uniform{0, maxKey};
+            for (auto& key : result)
+            {
+                key = uniform(generator);
+            }
+        }
+        break;
+    case Distribution::Sequential:
+        for (int i = 0; i < count; i++)
+        {
+            result[i] = static_cast<int>(i % (static_cast<long long>(maxKey) + 1));
+        }
+        break;
+    case Distribution::Zipf:
+        {
+            std::vector<double> weights(maxKey + 1);
+            for (int k = 0; k <= maxKey; k++)
+            {
+                weights[k] = 1.0 / (k + 1);
+            }
+            std::discrete_distribution<int> zipf{weights.begin(), weights.end()};
+            for (auto& key : result)
+            {
+                key = zipf(generator);
+            }
+        }
+        break;
+    }
+
+    return result;
+}
+
+/// @brief Stops the compiler from optimizing away benchmark results
+static volatile long long benchmarkSink = 0;
+
+/// @brief Runs a benchmark once and prints ns/op, throughput and allocations/op
+/// @param name The name of the benchmark
+/// @param operations The number of operations performed by the benchmark body
+/// @param body The code to measure
+template<typename TBody>
+static void runBenchmark(const char* name, long long operations, TBody&& body)
+{
+    long long allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+
+    body();
+
+    auto end = std::chrono::steady_clock::now();
+    long long allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+    double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+    double ops = static_cast<double>(std::max(1LL, operations));
+
+    std::printf("%-40s %10.2f ns/op %10.2f Mops/s %8.3f allocs/op\n",
+        name,
+        nanoseconds / ops,
+        (ops * 1000.0) / std::max(1.0, nanoseconds),
+        allocations / ops);
+}
+
+/// @brief Benchmarks set, get and a cache-aside loop (get, then set on a miss) on a single thread
+/// @param name The name of the cache type
+/// @param keys The key trace
+/// @param capacity The cache capacity
+template<typename TCache>
+static void benchmarkCache(const char* name, const std::vector<int>& keys, int capacity)
+{
+    long long operations = keys.size();
+    char benchmarkName[64];
+    TCache cache(capacity);
+
+    std::snprintf(benchmarkName, sizeof(benchmarkName), "%s::set", name);
+    runBenchmark(benchmarkName, operations, [&]() {
+        for (auto key : keys)
+        {
+            cache.set(key, key);
+        }
+    });
+
+    std::snprintf(benchmarkName, sizeof(benchmarkName), "%s::get", name);
+    runBenchmark(benchmarkName, operations, [&]() {
+        long long sum = 0;
+        for (auto key : keys)
+        {
+            sum += cache.get(key);
+        }
+        benchmarkSink = sum;
+    });
+
+    long long hits = 0;
+    TCache coldCache(capacity);
+    std::snprintf(benchmarkName, sizeof(benchmarkName), "%s::get/set (cache-aside)", name);
+    runBenchmark(benchmarkName, operations, [&]() {
+        for (auto key : keys)
+        {
+            if (coldCache.get(key) == -1)
+            {
+                coldCache.set(key, key);
+            }
+            else
+            {
+                hits++;
+            }
+        }
+    });
+    std::printf("%s cache-aside hit ratio: %.4f\n", name, static_cast<double>(hits) / operations);
+}
+
+/// @brief Benchmarks a read heavy loop (19 gets for every set) split over 1 to 64 threads, each
+/// thread working through its own slice of the key trace
+/// @param name The name of the cache type
+/// @param keys The key trace
+/// @param capacity The cache capacity
+template<typename TCache>
+static void benchmarkThreads(const char* name, const std::vector<int>& keys, int capacity)
+{
+    int operations = keys.size();
+
+    for (int threads = 1; threads <= 64; threads *= 2)
+    {
+        TCache cache(capacity, 64);
+        char benchmarkName[64];
+        std::snprintf(benchmarkName, sizeof(benchmarkName), "%s (%d threads)", name, threads);
+
+        runBenchmark(benchmarkName, operations, [&]() {
+            std::vector<std::thread> workers;
+            std::vector<long long> sums(threads);
+            for (int thread = 0; thread < threads; thread++)
+            {
+                workers.emplace_back([&, thread]() {
+                    long long sum = 0;
+                    for (int i = thread; i < operations; i += threads)
+                    {
+                        if ((i % 20) == 0)
+                        {
+                            cache.set(keys[i], keys[i]);
+                        }
+                        else
+                        {
+                            sum += cache.get(keys[i]);
+                        }
+                    }
+                    sums[thread] = sum;
+                });
+            }
+            for (int thread = 0; thread < threads; thread++)
+            {
+                workers[thread].join();
+                benchmarkSink = benchmarkSink + sums[thread];
+            }
+        });
+    }
+}
+
+/// @brief Returns the hit ratio of a cache-aside loop (get, then set on a miss) over a key trace
+/// @param cache 
+/// @param keys 
+/// @return 
+template<typename TCache>
+static double measureHitRatio(TCache&& cache, const std::vector<int>& keys)
+{
+    long long hits = 0;
+
+    for (auto key : keys)
+    {
+        if (cache.get(key) == -1)
+        {
+            cache.set(key, key);
+        }
+        else
+        {
+            hits++;
+        }
+    }
+
+    return static_cast<double>(hits) / std::max<size_t>(1, keys.size());
+}
+
+/// @brief Prints the hit ratio of each cache type on a key trace
+/// @param name The name of the trace
+/// @param keys The key trace
+/// @param capacity The cache capacity
+static void printHitRatios(const char* name, const std::vector<int>& keys, int capacity)
+{
+    std::printf("%-12s hit ratio: LRU %.4f, LRU + TinyLFU %.4f, CLOCK %.4f\n",
+        name,
+        measureHitRatio(LRUCache(capacity), keys),
+        measureHitRatio(LRUCache(capacity, true), keys),
+        measureHitRatio(ClockCache(capacity), keys));
+}
+
+int main(int argc, char* argv[])
+{
+    // usage: lru_cache [operations] [capacity] [uniform|sequential|zipf] [key space]
+    int operations = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    int capacity = (argc > 2) ? std::atoi(argv[2]) : 10000;
+    Distribution distribution = (argc > 3) ? parseDistribution(argv[3]) : Distribution::Zipf;
+    int keySpace = (argc > 4) ? std::atoi(argv[4]) : 100000;
+    if ((operations < 1) || (capacity < 1) || (keySpace < 0))
+    {
+        throw std::out_of_range("Operations and capacity must be at least 1 and key space not negative");
+    }
+
+    std::vector<int> keys = generateValues(operations, distribution, keySpace);
+    std::printf("operations=%d capacity=%d key space=%d\n", operations, capacity, keySpace);
+
+    // the same trace with a scan of capacity keys that are never seen again after every
+    // 5 * capacity accesses
+    std::vector<int> scanMixedKeys;
+    int nextScanKey = keySpace + 1;
+    for (int i = 0; i < operations; i++)
+    {
+        if ((i % (5 * capacity)) == 0)
+        {
+            for (int j = 0; j < capacity; j++)
+            {
+                scanMixedKeys.push_back(nextScanKey++);
+            }
+        }
+        scanMixedKeys.push_back(keys[i]);
+    }
+
+    printHitRatios("trace", keys, capacity);
+    printHitRatios("scan-mixed", scanMixedKeys, capacity);
+
+    {
+        // run the trace once more with every 64th call timed and print what the cache saw
+        LRUCache cache(capacity);
+        cache.set_latency_sampling(64);
+        measureHitRatio(cache, keys);
+
+        CacheStatistics statistics = cache.get_statistics();
+        std::printf("LRUCache statistics: hits=%lld misses=%lld inserts=%lld updates=%lld evictions=%lld hit ratio=%.4f\n",
+            statistics.hits,
+            statistics.misses,
+            statistics.inserts,
+            statistics.updates,
+            statistics.evictions,
+            statistics.hit_ratio());
+        for (int i = 0; i < CacheStatistics::LatencyBuckets; i++)
+        {
+            if (statistics.latencies[i] > 0)
+            {
+                std::printf("    %10lld ns and up: %lld\n", 1LL << i, statistics.latencies[i]);
+            }
+        }
+    }
+
+    benchmarkCache<LRUCache>("LRUCache", keys, capacity);
+    {
+        // the same loops as above but handing the keys to the cache 64 at a time
+        LRUCache cache(capacity);
+        std::vector<int> results(64);
+
+        runBenchmark("LRUCache::set_many (64)", operations, [&]() {
+            for (int i = 0; i < operations; i += 64)
+            {
+                cache.set_many(keys.data() + i, keys.data() + i, std::min(64, operations - i));
+            }
+        });
+
+        runBenchmark("LRUCache::get_many (64)", operations, [&]() {
+            long long sum = 0;
+            for (int i = 0; i < operations; i += 64)
+            {
+                cache.get_many(keys.data() + i, std::min(64, operations - i), results.data());
+                sum += results[0];
+            }
+            benchmarkSink = sum;
+        });
+    }
+
+    benchmarkCache<ClockCache>("ClockCache", keys, capacity);
+
+    {
+        // items cost between 1 and 64 "bytes" with a budget of 16 bytes per item of capacity, a
+        // quarter of them expire 10 to 1033 ms after being set
+        WeightedTTLCache cache(capacity, 16LL * capacity);
+        runBenchmark("WeightedTTLCache::set (cost, ttl)", operations, [&]() {
+            for (auto key : keys)
+            {
+                long long timeToLive = ((key % 4) == 0) ? (10 + (key % 1024)) : 0;
+                cache.set(key, key, 1 + (key % 64), timeToLive);
+            }
+        });
+
+        runBenchmark("WeightedTTLCache::get", operations, [&]() {
+            long long sum = 0;
+            for (auto key : keys)
+            {
+                sum += cache.get(key);
+            }
+            benchmarkSink = sum;
+        });
+        std::printf("WeightedTTLCache items=%d total cost=%lld\n", cache.size(), cache.total_cost());
+    }
+    benchmarkThreads<ShardedLRUCache>("ShardedLRUCache", keys, capacity);
+    benchmarkThreads<ShardedClockCache>("ShardedClockCache", keys, capacity);
+
+    return 0;
+}
+
+#endif
\ No newline at end of file
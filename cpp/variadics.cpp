@@ -1,23 +1,33 @@
 // Solves: https://www.hackerrank.com/challenges/cpp-variadics/problem?isFullScreen=true
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <type_traits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
-template <bool Bit, bool... BitsToRight>
-struct ReverseBits {
-    enum
-    { 
-        value = Bit + (2 * ReverseBits<BitsToRight...>::value)
-    };
-};
+/// @brief Packs a list of bits into an integer, the first bit being the least significant. A
+/// fold expression sets every bit in one pass, rather than recursing once per bit.
+/// @return
+template <bool... Bits>
+constexpr uint64_t pack_bits()
+{
+    static_assert(sizeof...(Bits) <= 64, "use BitPattern for lists wider than 64 bits");
 
-// specialization for when we are processing the last bit
-template <bool Bit>
-struct ReverseBits<Bit> {
-    enum
-    {
-        value = Bit
-    };
+    uint64_t result = 0;
+    int position = 0;
+    ((result |= uint64_t{Bits} << position++), ...);
+    return result;
+}
+
+template <bool... Bits>
+struct ReverseBits {
+    static constexpr uint64_t value = pack_bits<Bits...>();
 };
 
 // a solution which calculates, at compile time, the integer value of a variadic list of bits in reverse order
@@ -27,3 +37,556 @@ static constexpr int reversed_binary_value()
 {
     return ReverseBits<digits...>::value;
 }
+
+/// @brief Returns a mask of the lowest count bits
+/// @param count At most 64
+/// @return
+constexpr uint64_t low_mask(size_t count)
+{
+    return count >= 64 ? ~uint64_t{0} : (uint64_t{1} << count) - 1;
+}
+
+/// @brief Returns a mask of count bits starting at bit first
+/// @param first
+/// @param count first + count is at most 64
+/// @return
+constexpr uint64_t range_mask(size_t first, size_t count)
+{
+    return count == 0 ? 0 : low_mask(count) << first;
+}
+
+/// @brief Returns the number of set bits
+/// @param value
+/// @return
+constexpr int popcount(uint64_t value)
+{
+    int result = 0;
+    for (; value != 0; value &= value - 1)
+    {
+        result++;
+    }
+    return result;
+}
+
+/// @brief Returns the bits of an unsigned integer in reverse order, by swapping ever smaller
+/// halves: the two 32 bit halves, then the 16 bit halves of each, down to adjacent bits
+/// @param value
+/// @return
+template <typename TUnsigned>
+constexpr TUnsigned reverse_bits(TUnsigned value)
+{
+    static_assert(std::is_unsigned_v<TUnsigned> && sizeof(TUnsigned) <= 8, "reverse_bits needs an unsigned integer");
+
+    uint64_t result = value;
+    result = (result >> 32) | (result << 32);
+    result = ((result >> 16) & 0x0000ffff0000ffff) | ((result & 0x0000ffff0000ffff) << 16);
+    result = ((result >> 8) & 0x00ff00ff00ff00ff) | ((result & 0x00ff00ff00ff00ff) << 8);
+    result = ((result >> 4) & 0x0f0f0f0f0f0f0f0f) | ((result & 0x0f0f0f0f0f0f0f0f) << 4);
+    result = ((result >> 2) & 0x3333333333333333) | ((result & 0x3333333333333333) << 2);
+    result = ((result >> 1) & 0x5555555555555555) | ((result & 0x5555555555555555) << 1);
+    return static_cast<TUnsigned>(result >> (64 - 8 * sizeof(TUnsigned)));
+}
+
+/// @brief A fixed width pattern of bits, stored in as many 64 bit words as it needs, the first
+/// word holding the least significant bits. Bits above the width are always clear.
+/// @tparam Width The number of bits
+template <size_t Width>
+struct BitPattern {
+    static_assert(Width > 0, "a bit pattern needs at least one bit");
+
+    static constexpr size_t WordCount = (Width + 63) / 64;
+
+    std::array<uint64_t, WordCount> words{};
+
+    /// @brief Returns the pattern of a list of bits, the first bit being the least significant
+    /// @return
+    template <bool... Bits>
+    static constexpr BitPattern from_bits()
+    {
+        static_assert(sizeof...(Bits) <= Width, "too many bits for the pattern");
+
+        BitPattern result;
+        size_t position = 0;
+        ((result.words[position / 64] |= uint64_t{Bits} << (position % 64), position++), ...);
+        return result;
+    }
+
+    /// @brief Returns a pattern with count bits set, starting at bit first
+    /// @param first
+    /// @param count first + count is at most Width
+    /// @return
+    static constexpr BitPattern mask(size_t first, size_t count)
+    {
+        BitPattern result;
+        for (size_t word = 0; word < WordCount; word++)
+        {
+            // the part of [first, first + count) that falls in this word
+            size_t wordStart = word * 64;
+            size_t start = first > wordStart ? first : wordStart;
+            size_t end = first + count < wordStart + 64 ? first + count : wordStart + 64;
+            if (start < end)
+            {
+                result.words[word] = range_mask(start - wordStart, end - start);
+            }
+        }
+        return result;
+    }
+
+    constexpr bool test(size_t position) const
+    {
+        return (words[position / 64] >> (position % 64)) & 1;
+    }
+
+    constexpr void set(size_t position)
+    {
+        words[position / 64] |= uint64_t{1} << (position % 64);
+    }
+
+    /// @brief Returns the number of set bits
+    /// @return
+    constexpr size_t popcount() const
+    {
+        size_t result = 0;
+        for (uint64_t word : words)
+        {
+            result += ::popcount(word);
+        }
+        return result;
+    }
+
+    /// @brief Returns the pattern with bit i moved to bit Width - 1 - i. The words are reversed
+    /// whole, which leaves the pattern shifted up by the unused bits of the last word.
+    /// @return
+    constexpr BitPattern reverse() const
+    {
+        BitPattern reversed;
+        for (size_t word = 0; word < WordCount; word++)
+        {
+            reversed.words[word] = reverse_bits(words[WordCount - 1 - word]);
+        }
+        return reversed.shift_right(WordCount * 64 - Width);
+    }
+
+    /// @brief Returns the pattern shifted count bits towards the least significant bit
+    /// @param count
+    /// @return
+    constexpr BitPattern shift_right(size_t count) const
+    {
+        BitPattern result;
+        size_t wordShift = count / 64;
+        size_t bitShift = count % 64;
+        for (size_t word = 0; word + wordShift < WordCount; word++)
+        {
+            result.words[word] = words[word + wordShift] >> bitShift;
+            if (bitShift != 0 && word + wordShift + 1 < WordCount)
+            {
+                result.words[word] |= words[word + wordShift + 1] << (64 - bitShift);
+            }
+        }
+        return result;
+    }
+
+    constexpr BitPattern operator&(const BitPattern& other) const
+    {
+        BitPattern result;
+        for (size_t word = 0; word < WordCount; word++)
+        {
+            result.words[word] = words[word] & other.words[word];
+        }
+        return result;
+    }
+
+    constexpr BitPattern operator|(const BitPattern& other) const
+    {
+        BitPattern result;
+        for (size_t word = 0; word < WordCount; word++)
+        {
+            result.words[word] = words[word] | other.words[word];
+        }
+        return result;
+    }
+
+    constexpr BitPattern operator^(const BitPattern& other) const
+    {
+        BitPattern result;
+        for (size_t word = 0; word < WordCount; word++)
+        {
+            result.words[word] = words[word] ^ other.words[word];
+        }
+        return result;
+    }
+
+    constexpr BitPattern operator~() const
+    {
+        BitPattern result;
+        for (size_t word = 0; word < WordCount; word++)
+        {
+            result.words[word] = ~words[word];
+        }
+        // keep the bits above the width clear
+        result.words[WordCount - 1] &= low_mask(Width - (WordCount - 1) * 64);
+        return result;
+    }
+
+    constexpr bool operator==(const BitPattern& other) const
+    {
+        for (size_t word = 0; word < WordCount; word++)
+        {
+            if (words[word] != other.words[word])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr bool operator!=(const BitPattern& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/// @brief Like reversed_binary_value, but for lists of any length
+/// i.e. reversed_binary_pattern<1,0,1,1>() holds 13 in a single word
+/// @return
+template <bool... digits>
+constexpr BitPattern<sizeof...(digits)> reversed_binary_pattern()
+{
+    return BitPattern<sizeof...(digits)>::template from_bits<digits...>();
+}
+
+/// @brief Builds a lookup table at compile time
+/// @tparam TValue The type of the entries
+/// @tparam Size The number of entries
+/// @param function Returns the entry for an index
+/// @return
+template <typename TValue, size_t Size, typename TFunction>
+constexpr std::array<TValue, Size> make_lookup_table(TFunction function)
+{
+    std::array<TValue, Size> table{};
+    for (size_t i = 0; i < Size; i++)
+    {
+        table[i] = function(i);
+    }
+    return table;
+}
+
+// every byte with its bits reversed, and the number of bits set in every byte
+constexpr auto ByteReverseTable = make_lookup_table<uint8_t, 256>([](size_t i) { return reverse_bits(static_cast<uint8_t>(i)); });
+constexpr auto BytePopcountTable = make_lookup_table<uint8_t, 256>([](size_t i) { return static_cast<uint8_t>(popcount(i)); });
+// every nibble with its bits reversed. The first 16 entries of ByteReverseTable hold the same,
+// shifted into the high nibble.
+constexpr auto NibbleReverseTable = make_lookup_table<uint8_t, 16>([](size_t i) { return static_cast<uint8_t>(reverse_bits(static_cast<uint8_t>(i)) >> 4); });
+
+static_assert(reversed_binary_value<1, 0, 1, 1>() == 13, "the first bit is the least significant");
+static_assert(reverse_bits(uint64_t{1}) == uint64_t{1} << 63 && reverse_bits(uint16_t{0x00f1}) == 0x8f00);
+static_assert(ByteReverseTable[0x01] == 0x80 && ByteReverseTable[0xc4] == 0x23 && BytePopcountTable[0xff] == 8);
+static_assert(NibbleReverseTable[0x1] == 0x8 && NibbleReverseTable[0xc] == 0x3);
+static_assert(BitPattern<130>::mask(60, 70).popcount() == 70 && (~BitPattern<130>()).popcount() == 130);
+static_assert(BitPattern<130>::mask(0, 3).reverse() == BitPattern<130>::mask(127, 3));
+static_assert(reversed_binary_pattern<1, 0, 1, 1>().words[0] == 13);
+
+// Runtime kernels reversing the words of a bit array, reversed[i] = reverse_bits(words[count - 1 - i])
+
+/// @brief Reverses words one byte at a time with the compile time ByteReverseTable. Slower
+/// than bswap on every CPU the dispatch knows, so it is only run by the benchmark.
+/// @param words
+/// @param reversed Must not overlap words
+/// @param count The number of words
+[[maybe_unused]] static void reverse_words_table(const uint64_t* words, uint64_t* reversed, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t word = words[count - 1 - i];
+        uint64_t result = 0;
+        for (int byte = 0; byte < 8; byte++)
+        {
+            result |= uint64_t{ByteReverseTable[(word >> (8 * byte)) & 0xff]} << (56 - 8 * byte);
+        }
+        reversed[i] = result;
+    }
+}
+
+/// @brief Reverses words by swapping their bytes with bswap, leaving only the bits within each
+/// byte to swap with masks
+/// @param words
+/// @param reversed Must not overlap words
+/// @param count The number of words
+static void reverse_words_bswap(const uint64_t* words, uint64_t* reversed, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t result = __builtin_bswap64(words[count - 1 - i]);
+        result = ((result >> 4) & 0x0f0f0f0f0f0f0f0f) | ((result & 0x0f0f0f0f0f0f0f0f) << 4);
+        result = ((result >> 2) & 0x3333333333333333) | ((result & 0x3333333333333333) << 2);
+        result = ((result >> 1) & 0x5555555555555555) | ((result & 0x5555555555555555) << 1);
+        reversed[i] = result;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/// @brief Reverses words two at a time with SSSE3, reversing the 16 bytes with one byte shuffle
+/// and the bits of every byte by looking up each nibble with another
+__attribute__((target("ssse3")))
+static void reverse_words_ssse3(const uint64_t* words, uint64_t* reversed, size_t count)
+{
+    const __m128i byteOrder = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i lowNibbles = _mm_set1_epi8(0x0f);
+    // a reversed low nibble becomes the high nibble, and the other way round
+    const __m128i reversedIntoHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ByteReverseTable.data()));
+    const __m128i reversedIntoLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(NibbleReverseTable.data()));
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + count - i - 2));
+        block = _mm_shuffle_epi8(block, byteOrder);
+        __m128i low = _mm_and_si128(block, lowNibbles);
+        __m128i high = _mm_and_si128(_mm_srli_epi16(block, 4), lowNibbles);
+        block = _mm_or_si128(_mm_shuffle_epi8(reversedIntoHigh, low), _mm_shuffle_epi8(reversedIntoLow, high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(reversed + i), block);
+    }
+
+    reverse_words_bswap(words, reversed + i, count - i);
+}
+
+/// @brief Reverses words four at a time with AVX2. The byte shuffle only works within each 16
+/// byte lane, so the two lanes are swapped afterwards.
+__attribute__((target("avx2")))
+static void reverse_words_avx2(const uint64_t* words, uint64_t* reversed, size_t count)
+{
+    const __m256i byteOrder = _mm256_setr_epi8(
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i lowNibbles = _mm256_set1_epi8(0x0f);
+    const __m256i reversedIntoHigh = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(ByteReverseTable.data())));
+    const __m256i reversedIntoLow = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(NibbleReverseTable.data())));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + count - i - 4));
+        block = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(block, byteOrder), 0x4e);
+        __m256i low = _mm256_and_si256(block, lowNibbles);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(block, 4), lowNibbles);
+        block = _mm256_or_si256(_mm256_shuffle_epi8(reversedIntoHigh, low), _mm256_shuffle_epi8(reversedIntoLow, high));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(reversed + i), block);
+    }
+
+    reverse_words_bswap(words, reversed + i, count - i);
+}
+
+#endif
+
+using ReverseWordsKernel = void (*)(const uint64_t*, uint64_t*, size_t);
+
+/// @brief Returns the fastest word reversal kernel the CPU supports
+/// @return
+static ReverseWordsKernel select_reverse_kernel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return reverse_words_avx2;
+    }
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        return reverse_words_ssse3;
+    }
+#endif
+    return reverse_words_bswap;
+}
+
+/// @brief Reverses an array of bits of any length at runtime, so bit i moves to bit
+/// bitCount - 1 - i. The runtime counterpart of BitPattern::reverse.
+/// @param bits The bits, the first word holding the least significant bits. Bits above bitCount
+/// in the last word are ignored.
+/// @param bitCount
+/// @param reversed Receives the (bitCount + 63) / 64 reversed words, must not overlap bits
+/// @param kernel Reverses whole words
+inline void reverse_bit_array(const uint64_t* bits, size_t bitCount, uint64_t* reversed, ReverseWordsKernel kernel)
+{
+    // reversing whole words leaves the pattern shifted up by the unused bits of the last word
+    size_t count = (bitCount + 63) / 64;
+    size_t padding = count * 64 - bitCount;
+    if (padding == 0)
+    {
+        kernel(bits, reversed, count);
+        return;
+    }
+
+    // reverse and shift a block at a time, so the shift reads words that are still in cache
+    // instead of making a second pass over memory
+    constexpr size_t BlockWords = 512;
+    for (size_t start = 0; start < count; start += BlockWords)
+    {
+        size_t end = std::min(count, start + BlockWords);
+        kernel(bits + count - end, reversed + start, end - start);
+
+        // each word takes the low bits of the next one, so the last word of a block waits for
+        // the next block
+        for (size_t i = (start == 0) ? 0 : start - 1; i + 1 < end; i++)
+        {
+            reversed[i] = (reversed[i] >> padding) | (reversed[i + 1] << (64 - padding));
+        }
+    }
+    reversed[count - 1] >>= padding;
+}
+
+/// @brief Reverses an array of bits of any length with the fastest kernel the CPU supports
+inline void reverse_bit_array(const uint64_t* bits, size_t bitCount, uint64_t* reversed)
+{
+    static const ReverseWordsKernel kernel = select_reverse_kernel();
+    reverse_bit_array(bits, bitCount, reversed, kernel);
+}
+
+#ifdef BENCHMARK
+
+// Benchmark harness, build with -DBENCHMARK. Every benchmark reports the time per operation,
+// throughput and the number of heap allocations per operation.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+static std::atomic<long long> allocationCount{0};
+
+// replace the global allocation functions to count allocations. they are kept out of line so the
+// compiler doesn't pair the inlined malloc() and free() calls with new and delete and warn.
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* result = std::malloc((size > 0) ? size : 1);
+    if (result == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+/// @brief Stops the compiler from optimizing away benchmark results
+static volatile long long benchmarkSink = 0;
+
+/// @brief Runs a benchmark once and prints ns/op, throughput and allocations/op
+/// @param name The name of the benchmark
+/// @param operations The number of operations performed by the benchmark body
+/// @param body The code to measure
+template<typename TBody>
+static void runBenchmark(const char* name, long long operations, TBody&& body)
+{
+    long long allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+
+    body();
+
+    auto end = std::chrono::steady_clock::now();
+    long long allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+    double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+    double ops = static_cast<double>(std::max(1LL, operations));
+
+    std::printf("%-40s %10.2f ns/op %10.2f Mops/s %8.3f allocs/op\n",
+        name,
+        nanoseconds / ops,
+        (ops * 1000.0) / std::max(1.0, nanoseconds),
+        allocations / ops);
+}
+
+/// @brief Reverses an array of bits one bit at a time, the baseline for the kernels
+static void reverseBitArrayNaive(const uint64_t* bits, size_t bitCount, uint64_t* reversed)
+{
+    std::fill(reversed, reversed + (bitCount + 63) / 64, 0);
+    for (size_t i = 0; i < bitCount; i++)
+    {
+        if ((bits[i / 64] >> (i % 64)) & 1)
+        {
+            size_t position = bitCount - 1 - i;
+            reversed[position / 64] |= uint64_t{1} << (position % 64);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // usage: variadics [bits per array] [arrays]
+    // one operation is one bit array, so long arrays measure bandwidth and many short arrays
+    // measure the cost per call
+    size_t bitCount = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : (1 << 27) - 13;
+    size_t arrayCount = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 8;
+    size_t wordCount = (bitCount + 63) / 64;
+
+    std::vector<uint64_t> bits(wordCount * arrayCount);
+    std::mt19937_64 generator{12345};
+    for (auto& word : bits)
+    {
+        word = generator();
+    }
+    std::vector<uint64_t> expected(bits.size());
+    std::vector<uint64_t> reversed(bits.size());
+
+    struct Kernel
+    {
+        const char* name;
+        ReverseWordsKernel kernel;
+    };
+    std::vector<Kernel> kernels{{"reverse_bit_array table", reverse_words_table}, {"reverse_bit_array bswap", reverse_words_bswap}};
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        kernels.push_back({"reverse_bit_array ssse3", reverse_words_ssse3});
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        kernels.push_back({"reverse_bit_array avx2", reverse_words_avx2});
+    }
+#endif
+    kernels.push_back({"reverse_bit_array dispatched", select_reverse_kernel()});
+
+    std::printf("%zu arrays of %zu bits\n", arrayCount, bitCount);
+
+    runBenchmark("naive loop", arrayCount, [&]() {
+        for (size_t i = 0; i < arrayCount; i++)
+        {
+            reverseBitArrayNaive(bits.data() + i * wordCount, bitCount, expected.data() + i * wordCount);
+        }
+        benchmarkSink = expected[0];
+    });
+
+    for (const auto& kernel : kernels)
+    {
+        runBenchmark(kernel.name, arrayCount, [&]() {
+            for (size_t i = 0; i < arrayCount; i++)
+            {
+                reverse_bit_array(bits.data() + i * wordCount, bitCount, reversed.data() + i * wordCount, kernel.kernel);
+            }
+            benchmarkSink = reversed[0];
+        });
+
+        if (reversed != expected)
+        {
+            throw std::runtime_error("Kernel result differs from the naive loop !");
+        }
+    }
+
+    return 0;
+}
+
+#endif